@@ -1,7 +1,26 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <random>
 #include <string>
+#include <system_error>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 /*!
  * @brief
  *        Defines possible operations
@@ -9,27 +28,70 @@
 class BankAcc {
 public:
     BankAcc() = default;
+    explicit BankAcc(uint32_t p_id): m_id(p_id) {}
+
+    static bool canDeposit (int p_amount)              { return p_amount > 0; }
+    static bool canWithdraw(int p_amount, int p_balance) { return p_amount > 0 && p_amount <= p_balance; }
 
     bool deposit(int p_amount) {
-        if ( p_amount > 0 ) {
+        if ( canDeposit(p_amount) ) {
             m_balance += p_amount;
-            std::cout << "Deposit " << p_amount << " => " << m_balance << std::endl;
+            std::cout << "Deposit " << p_amount << " => " << m_balance << '\n';
             return true;
         }
         return false;
     }
 
     bool withdraw(int p_amount) {
-        if ( p_amount > 0 && p_amount <= m_balance ) {
+        if ( canWithdraw(p_amount, m_balance) ) {
             m_balance -= p_amount;
-            std::cout << "Withdraw " << p_amount << " => " << m_balance << std::endl;
+            std::cout << "Withdraw " << p_amount << " => " << m_balance << '\n';
             return true;
         }
         return false;
     }
 
+    int      balance(void) const { return m_balance; }
+    uint32_t id     (void) const { return m_id; }
+
 private:
-    int m_balance{0};
+    friend class BatchExecutor;
+    friend class CommandLog;
+    friend class ShardedEngine;
+
+    uint32_t m_id{0};      /*!< Identifies the account in a CommandLog */
+    int      m_balance{0};
+};
+
+/*!
+ * \brief Account shared between threads : the balance is only changed
+ *        by compare-and-swap loops, so that a withdrawal never overdraws
+ *        it, without any lock. Quiet, unlike BankAcc.
+ */
+class AtomicBankAcc {
+public:
+    explicit AtomicBankAcc(int p_balance = 0): m_balance(p_balance) {}
+
+    bool deposit(int p_amount) {
+        if ( !BankAcc::canDeposit(p_amount) ) { return false; }
+
+        int l_balance = m_balance.load(std::memory_order_relaxed);
+        while ( !m_balance.compare_exchange_weak(l_balance, l_balance + p_amount) ) {}
+        return true;
+    }
+
+    bool withdraw(int p_amount) {
+        int l_balance = m_balance.load(std::memory_order_relaxed);
+        do {
+            if ( !BankAcc::canWithdraw(p_amount, l_balance) ) { return false; }
+        } while ( !m_balance.compare_exchange_weak(l_balance, l_balance - p_amount) );
+        return true;
+    }
+
+    int balance(void) const { return m_balance.load(); }
+
+private:
+    alignas(64) std::atomic<int> m_balance;   /*!< A cache line per account */
 };
 
 // -------- COMMAND INTERFACE -------- //
@@ -38,15 +100,15 @@ private:
  */
 class IOperations {
 public:
-    IOperations(BankAcc& p_ba): m_ba(p_ba) {}
     virtual ~IOperations() = default;
 
     virtual void DO  (void) = 0;
     virtual void UNDO(void) = 0;
 
+    bool succeeded(void) const { return m_succeeded; }
+
 protected:
-    bool     m_succeeded{false};
-    BankAcc& m_ba;
+    bool m_succeeded{false};
 };
 
 // -------- CONCRETE COMMANDS -------- //
@@ -60,7 +122,7 @@ public:
 
     BankOperations(BankAcc& p_ba,
                    Action   p_ac,
-                   int      p_amount): IOperations(p_ba), m_action(p_ac), m_amount(p_amount) {}
+                   int      p_amount): m_ba(p_ba), m_action(p_ac), m_amount(p_amount) {}
     virtual ~BankOperations() = default;
 
     virtual void DO  (void) override {
@@ -90,8 +152,506 @@ public:
     }
 
 private:
-    Action m_action;
-    int    m_amount;
+    friend class BatchExecutor;
+    friend class CommandLog;
+    friend class ShardedEngine;
+
+    /*!
+     * \brief DO against a balance held by the caller : returns the new one.
+     */
+    int DO(int p_balance) {
+        if ( m_action == deposit ) {
+            m_succeeded = BankAcc::canDeposit(m_amount);
+            return m_succeeded ? p_balance + m_amount : p_balance;
+        }
+        m_succeeded = BankAcc::canWithdraw(m_amount, p_balance);
+        return m_succeeded ? p_balance - m_amount : p_balance;
+    }
+
+    /*!
+     * \brief UNDO against a balance held by the caller : returns the new one.
+     */
+    int UNDO(int p_balance) {
+        if ( !m_succeeded ) { return p_balance; }
+
+        if ( m_action == deposit ) {
+            m_succeeded = BankAcc::canWithdraw(m_amount, p_balance);
+            return m_succeeded ? p_balance - m_amount : p_balance;
+        }
+        m_succeeded = BankAcc::canDeposit(m_amount);
+        return m_succeeded ? p_balance + m_amount : p_balance;
+    }
+
+    BankAcc& m_ba;
+    Action   m_action;
+    int      m_amount;
+};
+
+/*!
+ * \brief The same commands, on an AtomicBankAcc.
+ */
+class AtomicBankOperations : public IOperations {
+public:
+    using Action = BankOperations::Action;
+
+    AtomicBankOperations(AtomicBankAcc& p_ba,
+                         Action         p_ac,
+                         int            p_amount): m_ba(p_ba), m_action(p_ac), m_amount(p_amount) {}
+    virtual ~AtomicBankOperations() = default;
+
+    virtual void DO  (void) override {
+        switch( m_action )
+        {
+        case Action::deposit :
+            m_succeeded = m_ba.deposit (m_amount);
+            break;
+        case Action::withraw:
+            m_succeeded = m_ba.withdraw(m_amount);
+            break;
+        }
+    }
+
+    virtual void UNDO(void) override {
+        if ( !m_succeeded ) { return; }
+
+        switch( m_action )
+        {
+        case Action::deposit :
+            m_succeeded = m_ba.withdraw(m_amount);
+            break;
+        case Action::withraw:
+            m_succeeded = m_ba.deposit (m_amount);
+            break;
+        }
+    }
+
+private:
+    AtomicBankAcc& m_ba;
+    Action         m_action;
+    int            m_amount;
+};
+
+// -------- TRANSACTIONS -------- //
+/*!
+ * \brief Runs a sequence of commands as a whole : if one of them fails,
+ *        those already done are undone, last one first. There is no
+ *        lock : other threads may see the intermediate states.
+ *
+ *        An UNDO may fail too (e.g. undoing a deposit whose money was
+ *        already withdrawn by someone else) : that command then reports
+ *        succeeded() == false and stays applied, the others are still
+ *        undone, and run() returns Outcome::rollbackFailed - the
+ *        transaction is left partial and it is up to the caller to
+ *        compensate. Put the commands that may fail (withdrawals) first :
+ *        the UNDO of a withdrawal is a deposit, which always succeeds.
+ */
+class Transaction {
+public:
+    enum class Outcome { committed, rolledBack, rollbackFailed };
+
+    Transaction& add(IOperations& p_op) { m_ops.push_back(&p_op); return *this; }
+    void         clear(void)            { m_ops.clear(); }
+
+    /*!
+     * \brief Returns committed if every command succeeded (and was kept),
+     *        rolledBack if one failed and all those before it were undone,
+     *        rollbackFailed if one of these UNDOs failed too.
+     */
+    Outcome run(void) {
+        for ( std::size_t i = 0; i < m_ops.size(); ++i ) {
+            m_ops[i]->DO();
+            if ( m_ops[i]->succeeded() ) { continue; }
+
+            Outcome l_outcome = Outcome::rolledBack;
+            while ( i > 0 ) {
+                m_ops[--i]->UNDO();
+                if ( !m_ops[i]->succeeded() ) { l_outcome = Outcome::rollbackFailed; }
+            }
+            return l_outcome;
+        }
+        return Outcome::committed;
+    }
+
+private:
+    std::vector<IOperations*> m_ops;
+};
+
+// -------- BATCH EXECUTOR -------- //
+/*!
+ * \brief Runs a batch of commands, compacting each run of adjacent
+ *        commands on the same account into a single balance update :
+ *        the run is played against a local copy of the balance, which
+ *        is stored once at the end, without any output.
+ *
+ *        Every command still records whether it succeeded, so that
+ *        UNDO - one by one or batched - behaves as if they had been
+ *        run one at a time.
+ */
+class BatchExecutor {
+public:
+    void DO(BankOperations* p_ops, std::size_t p_count) {
+        for ( std::size_t i = 0; i < p_count; ) {
+            BankAcc& l_acc     = p_ops[i].m_ba;
+            int      l_balance = l_acc.m_balance;
+            for ( ; i < p_count && &p_ops[i].m_ba == &l_acc; ++i ) {
+                l_balance = p_ops[i].DO(l_balance);
+            }
+            l_acc.m_balance = l_balance;
+            ++m_updates;
+        }
+    }
+
+    /*!
+     * \brief Undoes p_ops, last one first.
+     */
+    void UNDO(BankOperations* p_ops, std::size_t p_count) {
+        for ( std::size_t i = p_count; i > 0; ) {
+            BankAcc& l_acc     = p_ops[i - 1].m_ba;
+            int      l_balance = l_acc.m_balance;
+            for ( ; i > 0 && &p_ops[i - 1].m_ba == &l_acc; --i ) {
+                l_balance = p_ops[i - 1].UNDO(l_balance);
+            }
+            l_acc.m_balance = l_balance;
+            ++m_updates;
+        }
+    }
+
+    void DO  (std::vector<BankOperations>& p_ops) { DO  (p_ops.data(), p_ops.size()); }
+    void UNDO(std::vector<BankOperations>& p_ops) { UNDO(p_ops.data(), p_ops.size()); }
+
+    std::size_t balanceUpdates(void) const { return m_updates; }
+
+private:
+    std::size_t m_updates{0};
+};
+
+// -------- WRITE-AHEAD LOG -------- //
+/*!
+ * \brief CRC-32 (IEEE), table driven.
+ */
+inline uint32_t crc32(const void* p_data, std::size_t p_size) {
+    static constexpr auto s_table = [] {
+        std::array<uint32_t, 256> l_table{};
+        for ( uint32_t i = 0; i < 256; ++i ) {
+            uint32_t l_crc = i;
+            for ( int k = 0; k < 8; ++k ) { l_crc = (l_crc >> 1) ^ (0xEDB88320u & (0u - (l_crc & 1))); }
+            l_table[i] = l_crc;
+        }
+        return l_table;
+    }();
+
+    uint32_t l_crc = ~0u;
+    auto     l_byte = static_cast<const uint8_t*>(p_data);
+    for ( std::size_t i = 0; i < p_size; ++i ) { l_crc = s_table[(l_crc ^ l_byte[i]) & 0xFF] ^ (l_crc >> 8); }
+    return ~l_crc;
+}
+
+/*!
+ * \brief Append-only, binary log of the operations commands apply to
+ *        accounts, written before they are applied.
+ *
+ *        Records have a fixed size and a checksum. They are buffered and
+ *        written + synced every p_groupSize records (group commit) or on
+ *        commit() : a crash loses at most the uncommitted ones. UNDOs
+ *        are logged as the operation they apply (a deposit undone is a
+ *        withdrawal), so that replaying the log rebuilds the balances
+ *        without knowing the commands. Replay stops at the first record
+ *        whose checksum does not match, e.g. torn by a crash ; opening
+ *        the log cuts it there, so that new records can be replayed.
+ */
+class CommandLog {
+public:
+    struct Record {
+        uint32_t account;
+        int32_t  amount;
+        uint8_t  action;    /*!< BankOperations::Action */
+        uint8_t  pad[3];
+        uint32_t crc;       /*!< Of all the above       */
+    };
+    static_assert(sizeof(Record) == 16, "records are 16 bytes");
+
+    explicit CommandLog(const std::string& p_path, std::size_t p_groupSize = 256):
+        m_path(p_path), m_groupSize(std::max<std::size_t>(1, p_groupSize)) {
+        m_fd = ::open(p_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if ( m_fd < 0 ) { throw std::system_error(errno, std::generic_category(), p_path); }
+
+        // Cut a torn or corrupt tail : records appended after it could not be replayed.
+        try {
+            const off_t l_valid = static_cast<off_t>(scan(m_fd, m_path, [](const Record&) {}) * sizeof(Record));
+            const off_t l_end   = ::lseek(m_fd, 0, SEEK_END);
+            if ( l_end < 0 ) { throw std::system_error(errno, std::generic_category(), p_path); }
+            if ( l_end != l_valid ) {
+                if ( ::ftruncate(m_fd, l_valid) != 0 || ::fdatasync(m_fd) != 0 ) {
+                    throw std::system_error(errno, std::generic_category(), p_path);
+                }
+            }
+        }
+        catch ( ... ) {
+            ::close(m_fd);
+            throw;
+        }
+        m_pending.reserve(m_groupSize);
+    }
+
+    ~CommandLog() {
+        try { commit(); } catch ( const std::system_error& ) {}
+        ::close(m_fd);
+    }
+
+    CommandLog(const CommandLog&)            = delete;
+    CommandLog& operator=(const CommandLog&) = delete;
+
+    void DO  (BankOperations& p_op) { log(p_op, false); p_op.DO  (); }
+    void UNDO(BankOperations& p_op) { log(p_op, true ); p_op.UNDO(); }
+
+    void DO(BankOperations* p_ops, std::size_t p_count, BatchExecutor& p_executor) {
+        for ( std::size_t i = 0; i < p_count; ++i ) { log(p_ops[i], false); }
+        p_executor.DO(p_ops, p_count);
+    }
+
+    void UNDO(BankOperations* p_ops, std::size_t p_count, BatchExecutor& p_executor) {
+        for ( std::size_t i = p_count; i > 0; --i ) { log(p_ops[i - 1], true); }
+        p_executor.UNDO(p_ops, p_count);
+    }
+
+    /*!
+     * \brief Writes and syncs the buffered records.
+     */
+    void commit(void) {
+        if ( m_pending.empty() ) { return; }
+
+        const char* l_data = reinterpret_cast<const char*>(m_pending.data());
+        std::size_t l_size = m_pending.size() * sizeof(Record);
+        while ( l_size ) {
+            const ssize_t l_written = ::write(m_fd, l_data, l_size);
+            if ( l_written < 0 ) {
+                if ( errno == EINTR ) { continue; }
+                throw std::system_error(errno, std::generic_category(), m_path);
+            }
+            l_data += l_written;
+            l_size -= l_written;
+        }
+        if ( ::fdatasync(m_fd) != 0 ) { throw std::system_error(errno, std::generic_category(), m_path); }
+
+        m_pending.clear();
+        ++m_commits;
+    }
+
+    /*!
+     * \brief Replays the log at p_path on p_accounts (grown to fit the
+     *        account ids), quietly. Returns the number of records applied.
+     */
+    static std::size_t replay(const std::string& p_path, std::vector<BankAcc>& p_accounts) {
+        const int l_fd = ::open(p_path.c_str(), O_RDONLY);
+        if ( l_fd < 0 ) { throw std::system_error(errno, std::generic_category(), p_path); }
+
+        std::size_t l_applied = 0;
+        try {
+            l_applied = scan(l_fd, p_path, [&p_accounts](const Record& p_rec) {
+                if ( p_rec.account >= p_accounts.size() ) {
+                    for ( uint32_t l_id = p_accounts.size(); l_id <= p_rec.account; ++l_id ) {
+                        p_accounts.emplace_back(l_id);
+                    }
+                }
+                int& l_balance = p_accounts[p_rec.account].m_balance;
+                if ( p_rec.action == BankOperations::deposit ) {
+                    if ( BankAcc::canDeposit(p_rec.amount) ) { l_balance += p_rec.amount; }
+                }
+                else if ( BankAcc::canWithdraw(p_rec.amount, l_balance) ) {
+                    l_balance -= p_rec.amount;
+                }
+            });
+        }
+        catch ( ... ) {
+            ::close(l_fd);
+            throw;
+        }
+        ::close(l_fd);
+        return l_applied;
+    }
+
+    std::size_t commits(void) const { return m_commits; }
+
+private:
+    /*!
+     * \brief Calls p_visit(const Record&) on the records of p_fd from its
+     *        current offset, until the end of the file or the first one
+     *        torn or corrupt. Returns how many were visited.
+     */
+    template <typename Visitor>
+    static std::size_t scan(int p_fd, const std::string& p_path, Visitor&& p_visit) {
+        std::vector<Record> l_chunk(1 << 16);
+        char*               l_bytes = reinterpret_cast<char*>(l_chunk.data());
+        std::size_t         l_have  = 0;    // Bytes read, not visited yet
+        std::size_t         l_valid = 0;
+        for ( ;; ) {
+            const ssize_t l_read = ::read(p_fd, l_bytes + l_have, l_chunk.size() * sizeof(Record) - l_have);
+            if ( l_read < 0 ) {
+                if ( errno == EINTR ) { continue; }
+                throw std::system_error(errno, std::generic_category(), p_path);
+            }
+            if ( l_read == 0 ) { return l_valid; }  // A partial record left is a torn one
+
+            // Short reads may split a record : keep its head for the next one.
+            l_have += static_cast<std::size_t>(l_read);
+            const std::size_t l_count = l_have / sizeof(Record);
+            for ( std::size_t i = 0; i < l_count; ++i ) {
+                const Record& l_rec = l_chunk[i];
+                if ( crc32(&l_rec, offsetof(Record, crc)) != l_rec.crc ||
+                     l_rec.action > BankOperations::withraw ) { return l_valid; }
+                p_visit(l_rec);
+                ++l_valid;
+            }
+            l_have -= l_count * sizeof(Record);
+            std::memmove(l_bytes, l_bytes + l_count * sizeof(Record), l_have);
+        }
+    }
+
+    void log(const BankOperations& p_op, bool p_undo) {
+        // Undoing a command that failed changes nothing.
+        if ( p_undo && !p_op.m_succeeded ) { return; }
+
+        Record l_rec{};
+        l_rec.account = p_op.m_ba.m_id;
+        l_rec.amount  = p_op.m_amount;
+        l_rec.action  = static_cast<uint8_t>(p_op.m_action);
+        if ( p_undo ) {
+            l_rec.action = p_op.m_action == BankOperations::deposit ? BankOperations::withraw
+                                                                     : BankOperations::deposit;
+        }
+        l_rec.crc     = crc32(&l_rec, offsetof(Record, crc));
+        m_pending.push_back(l_rec);
+
+        if ( m_pending.size() >= m_groupSize ) { commit(); }
+    }
+
+    std::string         m_path;
+    int                 m_fd;
+    std::size_t         m_groupSize;
+    std::vector<Record> m_pending;
+    std::size_t         m_commits{0};
+};
+
+// -------- SHARDED ENGINE -------- //
+/*!
+ * \brief Owns many accounts and runs the commands against them on
+ *        one thread per shard.
+ *
+ *        Account p_id lives in shard (p_id % shards), whose accounts are
+ *        a contiguous array that only its thread writes. Commands are
+ *        routed to the shard of their account and run in submission
+ *        order there, so the commands of an account keep their order
+ *        while different shards run in parallel. Commands must outlive
+ *        drain(); they record their success for a later UNDO.
+ */
+class ShardedEngine {
+public:
+    ShardedEngine(std::size_t p_accounts, std::size_t p_shards):
+        m_shards(std::max<std::size_t>(1, p_shards)) {
+        try {
+            for ( std::size_t s = 0; s < m_shards.size(); ++s ) {
+                Shard& l_shard = m_shards[s];
+                for ( std::size_t l_id = s; l_id < p_accounts; l_id += m_shards.size() ) {
+                    l_shard.accounts.emplace_back(static_cast<uint32_t>(l_id));
+                }
+                l_shard.thread = std::thread([&l_shard] { l_shard.run(); });
+            }
+        } catch ( ... ) {
+            stop();    // Joinable threads would terminate() as m_shards is destroyed
+            throw;
+        }
+    }
+
+    ~ShardedEngine() { stop(); }
+
+    ShardedEngine(const ShardedEngine&)            = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    BankAcc& account(uint32_t p_id) {
+        return m_shards[p_id % m_shards.size()].accounts[p_id / m_shards.size()];
+    }
+
+    std::size_t shards(void) const { return m_shards.size(); }
+
+    /*!
+     * \brief Queues p_ops, that must target accounts of this engine.
+     */
+    void submit(BankOperations* p_ops, std::size_t p_count) {
+        std::vector<std::vector<BankOperations*> > l_parts(m_shards.size());
+        for ( auto& l_part : l_parts ) { l_part.reserve(p_count / m_shards.size() + 1); }
+        for ( std::size_t i = 0; i < p_count; ++i ) {
+            l_parts[p_ops[i].m_ba.m_id % m_shards.size()].push_back(p_ops + i);
+        }
+
+        for ( std::size_t s = 0; s < m_shards.size(); ++s ) {
+            if ( l_parts[s].empty() ) { continue; }
+            {
+                std::lock_guard<std::mutex> l_lock(m_shards[s].mutex);
+                m_shards[s].queue.push_back(std::move(l_parts[s]));
+                ++m_shards[s].submitted;
+            }
+            m_shards[s].wakeUp.notify_all();
+        }
+    }
+
+    /*!
+     * \brief Waits until every command submitted so far has run.
+     */
+    void drain(void) {
+        for ( auto& l_shard : m_shards ) {
+            std::unique_lock<std::mutex> l_lock(l_shard.mutex);
+            const uint64_t l_target = l_shard.submitted;
+            l_shard.wakeUp.wait(l_lock, [&] { return l_shard.processed >= l_target; });
+        }
+    }
+
+private:
+    /*!
+     * \brief Stops and joins the threads started so far.
+     */
+    void stop(void) {
+        for ( auto& l_shard : m_shards ) {
+            if ( !l_shard.thread.joinable() ) { continue; }
+            {
+                std::lock_guard<std::mutex> l_lock(l_shard.mutex);
+                l_shard.stop = true;
+            }
+            l_shard.wakeUp.notify_all();
+            l_shard.thread.join();
+        }
+    }
+
+    struct alignas(64) Shard {
+        std::vector<BankAcc>                        accounts;
+        std::mutex                                  mutex;
+        std::condition_variable                     wakeUp;
+        std::deque<std::vector<BankOperations*> >   queue;
+        uint64_t                                    submitted{0};
+        uint64_t                                    processed{0};
+        bool                                        stop{false};
+        std::thread                                 thread;
+
+        void run(void) {
+            std::unique_lock<std::mutex> l_lock(mutex);
+            for (;;) {
+                wakeUp.wait(l_lock, [this] { return !queue.empty() || stop; });
+                if ( queue.empty() ) { return; }
+
+                auto l_batch = std::move(queue.front());
+                queue.pop_front();
+                l_lock.unlock();
+                for ( auto l_op : l_batch ) {
+                    int& l_balance = l_op->m_ba.m_balance;
+                    l_balance = l_op->DO(l_balance);
+                }
+                l_lock.lock();
+                ++processed;
+                wakeUp.notify_all();
+            }
+        }
+    };
+
+    std::deque<Shard> m_shards;   /*!< deque : Shards do not move */
 };
 
 // ----------- CLIENT CODE ---------- //
@@ -115,12 +675,315 @@ void clientCode(BankAcc& clientAcc) {
                op++ )            { op->UNDO(); } // Undo them
 }
 
+// ------------ BENCHMARKS ---------- //
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+double nsPer(Clock::time_point p_start, std::size_t p_count) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - p_start).count() / p_count;
+}
+
+/*!
+ * \brief Random deposits/withdrawals spread over p_accounts, in runs of
+ *        about p_run commands on the same account.
+ */
+std::vector<BankOperations> operations(std::vector<BankAcc>& p_accounts, std::size_t p_count, std::size_t p_run) {
+    std::mt19937                       l_rng{42};
+    std::uniform_int_distribution<int> l_amount{1, 100};
+    std::uniform_int_distribution<std::size_t> l_account{0, p_accounts.size() - 1};
+
+    std::vector<BankOperations> l_ops;
+    l_ops.reserve(p_count);
+    while ( l_ops.size() < p_count ) {
+        BankAcc& l_acc = p_accounts[l_account(l_rng)];
+        for ( std::size_t i = 0; i < p_run && l_ops.size() < p_count; ++i ) {
+            l_ops.emplace_back(l_acc,
+                               l_rng() % 3 ? BankOperations::Action::deposit : BankOperations::Action::withraw,
+                               l_amount(l_rng));
+        }
+    }
+    return l_ops;
+}
+
+/*!
+ * \brief Replays 10M commands one by one (output to nowhere) and batched.
+ */
+void batch() {
+    const std::size_t l_count = 10000000;
+
+    for ( std::size_t l_run : {1u, 16u, 256u} ) {
+        std::vector<BankAcc> l_single (1000), l_batched(1000);
+        auto l_ops  = operations(l_single,  l_count, l_run);
+        auto l_ops2 = operations(l_batched, l_count, l_run);
+
+        std::streambuf* l_cout = std::cout.rdbuf(nullptr);    // Drops the output
+        auto l_start = Clock::now();
+        for ( auto& op : l_ops ) { op.DO(); }
+        const double l_singleNs = nsPer(l_start, l_count);
+        std::cout.clear();
+        std::cout.rdbuf(l_cout);
+
+        BatchExecutor l_executor;
+        l_start = Clock::now();
+        l_executor.DO(l_ops2);
+        const double l_batchNs = nsPer(l_start, l_count);
+
+        bool l_same = true;
+        for ( std::size_t i = 0; i < l_single.size(); ++i ) {
+            l_same &= l_batched[i].balance() == l_single[i].balance();
+        }
+
+        l_start = Clock::now();
+        l_executor.UNDO(l_ops2);
+        const double l_undoNs = nsPer(l_start, l_count);
+
+        bool l_restored = true;
+        for ( auto& l_acc : l_batched ) {
+            l_restored &= l_acc.balance() == 0;
+        }
+
+        std::printf("batch run=%-4zu one by one %6.1f ns, batched DO %5.1f ns, UNDO %5.1f ns per command"
+                    " (%zu balance updates, same balances : %s, restored : %s)\n",
+                    l_run, l_singleNs, l_batchNs, l_undoNs, l_executor.balanceUpdates(),
+                    l_same ? "yes" : "no", l_restored ? "yes" : "no");
+    }
+}
+
+/*!
+ * \brief Commit throughput per group commit size, then replay speed
+ *        of a 100M records log.
+ */
+void wal() {
+    const std::string l_path = (std::filesystem::temp_directory_path() / "command_bench.wal").string();
+
+    std::vector<BankAcc> l_accounts;
+    for ( uint32_t i = 0; i < 1000; ++i ) { l_accounts.emplace_back(i); }
+    auto          l_ops = operations(l_accounts, 1 << 20, 16);
+    BatchExecutor l_executor;
+
+    for ( std::size_t l_group : {1u, 16u, 256u, 4096u, 65536u} ) {
+        ::unlink(l_path.c_str());
+        const std::size_t l_count = std::min<std::size_t>(l_ops.size(), l_group * 1000);
+
+        auto l_start = Clock::now();
+        {
+            CommandLog l_log(l_path, l_group);
+            for ( std::size_t i = 0; i < l_count; i += 1024 ) {
+                l_log.DO(l_ops.data() + i, std::min<std::size_t>(1024, l_count - i), l_executor);
+            }
+        }
+        const double l_ns = nsPer(l_start, l_count);
+        std::printf("wal group=%-6zu %10.0f commands/s (%zu commands)\n", l_group, 1e9 / l_ns, l_count);
+    }
+
+    // 100M records, from empty accounts
+    const std::size_t l_records = 100000000;
+    ::unlink(l_path.c_str());
+    for ( auto& l_acc : l_accounts ) { l_acc = BankAcc(l_acc.id()); }
+    {
+        CommandLog l_log(l_path, 1 << 20);
+        for ( std::size_t l_done = 0; l_done < l_records; l_done += l_ops.size() ) {
+            l_log.DO(l_ops.data(), std::min(l_ops.size(), l_records - l_done), l_executor);
+        }
+    }
+
+    std::vector<BankAcc> l_rebuilt;
+    auto l_start = Clock::now();
+    const std::size_t l_applied = CommandLog::replay(l_path, l_rebuilt);
+    const double      l_ns      = nsPer(l_start, l_applied);
+
+    bool l_same = l_rebuilt.size() == l_accounts.size();
+    for ( std::size_t i = 0; l_same && i < l_accounts.size(); ++i ) {
+        l_same = l_rebuilt[i].balance() == l_accounts[i].balance();
+    }
+    std::printf("wal replay %zu records : %.2f s, %.1f ns/record, %.0f MiB/s (balances match : %s)\n",
+                l_applied, l_ns * l_applied / 1e9, l_ns,
+                sizeof(CommandLog::Record) * 1e3 / l_ns / 1.048576, l_same ? "yes" : "no");
+    ::unlink(l_path.c_str());
+}
+
+/*!
+ * \brief Zipf(p_s) distributed ranks in [0, p_n), through the inverse CDF.
+ */
+class Zipf {
+public:
+    Zipf(std::size_t p_n, double p_s): m_cdf(p_n) {
+        double l_sum = 0.;
+        for ( std::size_t i = 0; i < p_n; ++i ) { m_cdf[i] = l_sum += 1. / std::pow(i + 1., p_s); }
+        for ( auto& l_p : m_cdf ) { l_p /= l_sum; }
+    }
+
+    template <typename R>
+    std::size_t operator()(R& p_rng) {
+        const double l_u = std::uniform_real_distribution<double>{0., 1.}(p_rng);
+        return std::lower_bound(std::begin(m_cdf), std::end(m_cdf), l_u) - std::begin(m_cdf);
+    }
+
+private:
+    std::vector<double> m_cdf;
+};
+
+/*!
+ * \brief 1M accounts, uniform and Zipf(0.99) traffic, 1 to 8 shards.
+ */
+void sharded() {
+    const std::size_t l_accounts = 1000000;
+    const std::size_t l_count    = 4000000;
+    const std::size_t l_batch    = 65536;
+    const int         l_rounds   = 3;
+
+    std::printf("sharded on %u hardware threads\n", std::thread::hardware_concurrency());
+    for ( bool l_zipf : {false, true} ) {
+        // Account of each command ; hot Zipf ranks scattered over the ids
+        std::mt19937_64 l_rng{7};
+        std::vector<uint32_t> l_ids(l_count);
+        std::vector<int>      l_amounts(l_count);
+        std::vector<bool>     l_deposits(l_count);
+        Zipf                  l_ranks(l_accounts, 0.99);
+        std::uniform_int_distribution<uint32_t> l_uniform{0, l_accounts - 1};
+        for ( std::size_t i = 0; i < l_count; ++i ) {
+            l_ids[i]      = l_zipf ? static_cast<uint32_t>((l_ranks(l_rng) * 2654435761u) % l_accounts)
+                                   : l_uniform(l_rng);
+            l_amounts[i]  = 1 + l_rng() % 100;
+            l_deposits[i] = l_rng() % 3 != 0;
+        }
+
+        // Sequential reference
+        std::vector<int> l_expected(l_accounts, 0);
+        for ( int r = 0; r < l_rounds; ++r ) {
+            for ( std::size_t i = 0; i < l_count; ++i ) {
+                int& l_balance = l_expected[l_ids[i]];
+                if ( l_deposits[i] ) { l_balance += BankAcc::canDeposit(l_amounts[i]) ? l_amounts[i] : 0; }
+                else if ( BankAcc::canWithdraw(l_amounts[i], l_balance) ) { l_balance -= l_amounts[i]; }
+            }
+        }
+
+        for ( std::size_t l_shards : {1u, 2u, 4u, 8u} ) {
+            ShardedEngine l_engine(l_accounts, l_shards);
+            std::vector<BankOperations> l_ops;
+            l_ops.reserve(l_count);
+            for ( std::size_t i = 0; i < l_count; ++i ) {
+                l_ops.emplace_back(l_engine.account(l_ids[i]),
+                                   l_deposits[i] ? BankOperations::Action::deposit : BankOperations::Action::withraw,
+                                   l_amounts[i]);
+            }
+
+            const auto l_start = Clock::now();
+            for ( int r = 0; r < l_rounds; ++r ) {
+                for ( std::size_t i = 0; i < l_count; i += l_batch ) {
+                    l_engine.submit(l_ops.data() + i, std::min(l_batch, l_count - i));
+                }
+                l_engine.drain();   // Commands are reused by the next round
+            }
+            const double l_ns = nsPer(l_start, l_count * l_rounds);
+
+            bool l_same = true;
+            for ( uint32_t l_id = 0; l_same && l_id < l_accounts; ++l_id ) {
+                l_same = l_engine.account(l_id).balance() == l_expected[l_id];
+            }
+            std::printf("sharded %-7s accounts=%zu shards=%zu : %6.1f M commands/s (in order : %s)\n",
+                        l_zipf ? "zipf" : "uniform", l_accounts, l_shards, 1e3 / l_ns, l_same ? "yes" : "no");
+        }
+    }
+}
+
+/*!
+ * \brief 64 threads transferring between 1k accounts : lock-free
+ *        transactions against a single lock around plain balances.
+ */
+void transfers() {
+    const std::size_t l_accounts  = 1000;
+    const int         l_threads   = 64;
+    const int         l_transfers = 100000;    // Per thread
+    const int         l_initial   = 1000;
+
+    // Lock-free
+    std::vector<AtomicBankAcc> l_atomic(l_accounts);
+    for ( auto& l_acc : l_atomic ) { l_acc.deposit(l_initial); }
+
+    std::atomic<uint64_t>    l_committed{0};
+    std::vector<std::thread> l_workers;
+    auto l_start = Clock::now();
+    for ( int t = 0; t < l_threads; ++t ) {
+        l_workers.emplace_back([&, t] {
+            std::mt19937 l_rng(t);
+            std::uniform_int_distribution<std::size_t> l_pick{0, l_accounts - 1};
+            std::uniform_int_distribution<int>         l_amount{1, 200};
+            Transaction l_tx;
+            uint64_t    l_done = 0;
+            for ( int i = 0; i < l_transfers; ++i ) {
+                const std::size_t l_from = l_pick(l_rng), l_to = (l_from + 1 + l_pick(l_rng) % (l_accounts - 1)) % l_accounts;
+                const int         l_sum  = l_amount(l_rng);
+                AtomicBankOperations l_withdraw(l_atomic[l_from], AtomicBankOperations::Action::withraw, l_sum);
+                AtomicBankOperations l_deposit (l_atomic[l_to],   AtomicBankOperations::Action::deposit, l_sum);
+                l_tx.clear();
+                l_done += l_tx.add(l_withdraw).add(l_deposit).run() == Transaction::Outcome::committed;
+            }
+            l_committed += l_done;
+        });
+    }
+    for ( auto& l_worker : l_workers ) { l_worker.join(); }
+    const double l_atomicNs = nsPer(l_start, std::size_t(l_threads) * l_transfers);
+
+    long long l_total = 0;
+    for ( auto& l_acc : l_atomic ) { l_total += l_acc.balance(); }
+
+    // One lock
+    std::vector<int> l_plain(l_accounts, l_initial);
+    std::mutex       l_mutex;
+    l_workers.clear();
+    l_start = Clock::now();
+    for ( int t = 0; t < l_threads; ++t ) {
+        l_workers.emplace_back([&, t] {
+            std::mt19937 l_rng(t);
+            std::uniform_int_distribution<std::size_t> l_pick{0, l_accounts - 1};
+            std::uniform_int_distribution<int>         l_amount{1, 200};
+            for ( int i = 0; i < l_transfers; ++i ) {
+                const std::size_t l_from = l_pick(l_rng), l_to = (l_from + 1 + l_pick(l_rng) % (l_accounts - 1)) % l_accounts;
+                const int         l_sum  = l_amount(l_rng);
+                std::lock_guard<std::mutex> l_lock(l_mutex);
+                if ( BankAcc::canWithdraw(l_sum, l_plain[l_from]) ) {
+                    l_plain[l_from] -= l_sum;
+                    l_plain[l_to]   += l_sum;
+                }
+            }
+        });
+    }
+    for ( auto& l_worker : l_workers ) { l_worker.join(); }
+    const double l_lockedNs = nsPer(l_start, std::size_t(l_threads) * l_transfers);
+
+    std::printf("transfers threads=%d accounts=%zu : lock-free %6.1f ns, global lock %6.1f ns per transfer"
+                " (%.1f%% committed, money conserved : %s) on %u hardware threads\n",
+                l_threads, l_accounts, l_atomicNs, l_lockedNs,
+                100. * l_committed.load() / (double(l_threads) * l_transfers),
+                l_total == (long long)l_initial * l_accounts ? "yes" : "no",
+                std::thread::hardware_concurrency());
+}
+
+} // namespace bench
+
 // ------------- MAIN --------------- //
 /*!
  * \brief Command interface
+ *        Run with --bench to measure the executors instead.
  */
-int main()
+int main(int argc, char** argv)
 {
+    if ( argc > 1 && std::strcmp(argv[1], "--bench") == 0 ) {
+        // Every benchmark, or those named after --bench
+        auto l_selected = [&](const char* p_name) {
+            bool l_all = argc == 2;
+            for ( int i = 2; i < argc; ++i ) { l_all |= std::strcmp(argv[i], p_name) == 0; }
+            return l_all;
+        };
+        if ( l_selected("batch")     ) { bench::batch();     }
+        if ( l_selected("wal")       ) { bench::wal();       }
+        if ( l_selected("sharded")   ) { bench::sharded();   }
+        if ( l_selected("transfers") ) { bench::transfers(); }
+        return 0;
+    }
+
     BankAcc clientAcc;
 
     clientCode(clientAcc);
@@ -0,0 +1,66 @@
+#include "BenchUtils.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+/*!
+ * Allocation accounting : every allocation is prefixed with its size
+ * so that the live heap can be tracked without an allocator hook.
+ */
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<int64_t>  g_liveBytes{0};
+constexpr std::size_t kAllocHeader = alignof(std::max_align_t);
+
+} // namespace
+
+void* operator new(std::size_t p_size)
+{
+  auto* l_raw = static_cast<char*>(std::malloc(p_size + kAllocHeader));
+  if ( !l_raw ) throw std::bad_alloc();
+  *reinterpret_cast<std::size_t*>(l_raw) = p_size;
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_liveBytes.fetch_add(static_cast<int64_t>(p_size), std::memory_order_relaxed);
+  return l_raw + kAllocHeader;
+}
+
+void operator delete(void* p_ptr) noexcept
+{
+  if ( !p_ptr ) return;
+  auto* l_raw = static_cast<char*>(p_ptr) - kAllocHeader;
+  g_liveBytes.fetch_sub(static_cast<int64_t>(*reinterpret_cast<std::size_t*>(l_raw)), std::memory_order_relaxed);
+  std::free(l_raw);
+}
+
+void operator delete(void* p_ptr, std::size_t) noexcept { operator delete(p_ptr); }
+
+namespace bench {
+
+uint64_t allocations(void) { return g_allocations.load(std::memory_order_relaxed); }
+int64_t  liveBytes  (void) { return g_liveBytes  .load(std::memory_order_relaxed); }
+
+uint64_t residentBytes(void)
+{
+  unsigned long l_size = 0, l_resident = 0;
+  if ( FILE* l_statm = std::fopen("/proc/self/statm", "r") )
+  {
+    if ( std::fscanf(l_statm, "%lu %lu", &l_size, &l_resident) != 2 ) l_resident = 0;
+    std::fclose(l_statm);
+  }
+  return static_cast<uint64_t>(l_resident) * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+}
+
+uint64_t peakResidentBytes(void)
+{
+  struct rusage l_usage;
+  ::getrusage(RUSAGE_SELF, &l_usage);
+  return static_cast<uint64_t>(l_usage.ru_maxrss) * 1024; // Kilobytes on Linux
+}
+
+} // namespace bench
@@ -0,0 +1,99 @@
+#ifndef  BENCHUTILS_H
+#define BENCHUTILS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "IChatRoom.hpp"
+#include "Person.hpp"
+
+/*!
+ * Helpers shared by the benchmark executables.
+ * Linking BenchUtils.cpp replaces the global operator new/delete
+ * to account for heap allocations.
+ */
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedNs(Clock::time_point p_start, std::size_t p_ops)
+{
+  auto l_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - p_start).count();
+  return static_cast<double>(l_ns) / static_cast<double>(p_ops);
+}
+
+/*!
+ * @brief p_rank-th percentile (0 <= p_rank <= 1). Reorders p_samples.
+ */
+inline double percentile(std::vector<double> &p_samples, double p_rank)
+{
+  if ( p_samples.empty() ) return 0.;
+  std::size_t l_nth = static_cast<std::size_t>(p_rank * (p_samples.size() - 1));
+  std::nth_element(std::begin(p_samples), std::begin(p_samples) + l_nth, std::end(p_samples));
+  return p_samples[l_nth];
+}
+
+/*!
+ * @brief Swallows everything written to std::cout while alive, so that
+ *        the measures are not bound by the terminal.
+ */
+class MuteCout
+{
+  public:
+    MuteCout() : m_old(std::cout.rdbuf(&m_null)) {}
+    ~MuteCout() { std::cout.rdbuf(m_old); }
+
+  private:
+    struct NullBuffer : std::streambuf
+    {
+      int overflow(int p_c) override { return p_c; }
+      std::streamsize xsputn(const char*, std::streamsize p_n) override { return p_n; }
+    };
+
+    NullBuffer      m_null;
+    std::streambuf* m_old;
+};
+
+inline std::vector<std::unique_ptr<Person>> populate(IChatRoom &p_room, std::size_t p_count)
+{
+  std::vector<std::unique_ptr<Person>> l_people;
+  l_people.reserve(p_count);
+  for (std::size_t i = 0; i < p_count; ++i)
+    l_people.emplace_back(std::make_unique<Person>("user" + std::to_string(i), p_room));
+  return l_people;
+}
+
+/*!
+ * @brief Destroys the Persons, most recent first.
+ */
+inline void release(std::vector<std::unique_ptr<Person>> &p_people)
+{
+  while ( !p_people.empty() )
+    p_people.pop_back();
+}
+
+/*!
+ * @brief Number of heap allocations since the program started.
+ */
+uint64_t allocations(void);
+
+/*!
+ * @brief Bytes currently allocated on the heap.
+ */
+int64_t liveBytes(void);
+
+/*!
+ * @brief Current and peak resident set size, in bytes.
+ */
+uint64_t residentBytes(void);
+uint64_t peakResidentBytes(void);
+
+} // namespace bench
+
+#endif // BENCHUTILS_H
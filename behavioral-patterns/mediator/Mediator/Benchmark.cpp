@@ -0,0 +1,559 @@
+/*!
+ * Micro-benchmarks for the Mediator example.
+ *
+ * Usage : MediatorBenchmark [scenario...]
+ *         Runs every scenario when none is given.
+ */
+
+#include "BenchUtils.hpp"
+#include "ChatRoom.hpp"
+#include "ConcurrentChatRoom.hpp"
+#include "DeliveryPool.hpp"
+#include "Journal.hpp"
+#include "TopicRouter.hpp"
+#include "BufferedSink.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace bench;
+
+/*!
+ * @brief Private messages : name scan (former ChatRoom::message)
+ *        against the interned name index.
+ */
+void benchPrivateMessages()
+{
+  for (std::size_t l_members : {10000u, 100000u})
+  {
+    MuteCout l_mute;
+    ChatRoom l_room{false};
+    auto     l_people = populate(l_room, l_members);
+
+    const std::size_t l_ops = 2000;
+    std::mt19937 l_rng{42};
+    std::uniform_int_distribution<std::size_t> l_pick{0, l_members - 1};
+    std::vector<std::string> l_targets;
+    for (std::size_t i = 0; i < l_ops; ++i)
+      l_targets.push_back("user" + std::to_string(l_pick(l_rng)));
+
+    auto l_start = Clock::now();
+    for (const auto& l_to : l_targets)
+    {
+      auto l_it = std::find_if(std::begin(l_people), std::end(l_people),
+                               [&](const std::unique_ptr<Person>& p) { return p->getName() == l_to; });
+      if ( l_it != std::end(l_people) ) (*l_it)->receive(Message::create("bench", "ping"));
+    }
+    double l_scan = elapsedNs(l_start, l_ops);
+
+    l_start = Clock::now();
+    for (const auto& l_to : l_targets)
+      l_room.message(l_to, Message::create("bench", "ping"));
+    double l_index = elapsedNs(l_start, l_ops);
+
+    release(l_people);
+    std::printf("pm        members=%-7zu name-scan=%10.1f ns/msg  index=%8.1f ns/msg  (x%.0f)\n",
+                l_members, l_scan, l_index, l_scan / l_index);
+  }
+}
+
+/*!
+ * @brief Broadcast cost per recipient.
+ */
+void benchBroadcast()
+{
+  for (std::size_t l_members : {10000u, 100000u})
+  {
+    MuteCout l_mute;
+    ChatRoom l_room{false};
+    auto     l_people = populate(l_room, l_members);
+
+    const std::size_t l_ops = 20;
+    auto l_start = Clock::now();
+    for (std::size_t i = 0; i < l_ops; ++i)
+      l_people[i]->say("hello everyone");
+    double l_ns = elapsedNs(l_start, l_ops * (l_members - 1));
+
+    release(l_people);
+    std::printf("broadcast members=%-7zu %8.1f ns/recipient\n", l_members, l_ns);
+  }
+}
+
+/*!
+ * @brief Broadcast throughput of ConcurrentChatRoom
+ *        with an increasing number of sending threads.
+ */
+void benchConcurrentBroadcast()
+{
+  const std::size_t l_members = 10000;
+  const std::size_t l_perThread = 10;
+
+  MuteCout           l_mute;
+  ConcurrentChatRoom l_room{0, false};
+  auto               l_people = populate(l_room, l_members);
+
+  double l_reference = 0.;
+  for (std::size_t l_threads : {1u, 2u, 4u, 8u, 16u, 32u})
+  {
+    std::vector<std::thread> l_workers;
+    auto l_start = Clock::now();
+    for (std::size_t t = 0; t < l_threads; ++t)
+      l_workers.emplace_back([&, t] {
+        for (std::size_t i = 0; i < l_perThread; ++i)
+          l_people[(t * l_perThread + i) % l_members]->say("hello everyone");
+      });
+    for (auto& l_worker : l_workers)
+      l_worker.join();
+
+    double l_ns         = elapsedNs(l_start, l_threads * l_perThread * (l_members - 1));
+    double l_throughput = 1e3 / l_ns;
+    if ( l_threads == 1 ) l_reference = l_throughput;
+    std::printf("concurrent threads=%-3zu %8.2f M deliveries/s  (x%.2f)\n",
+                l_threads, l_throughput, l_throughput / l_reference);
+  }
+  release(l_people);
+}
+
+/*!
+ * @brief Hammers join/leave and private messages while
+ *        other threads keep broadcasting.
+ */
+void stressConcurrentChurn()
+{
+  const std::size_t l_members = 1000;
+  const auto        l_duration = std::chrono::seconds(2);
+
+  MuteCout           l_mute;
+  ConcurrentChatRoom l_room{8, false};
+  auto               l_people = populate(l_room, l_members);
+
+  std::atomic<bool>        l_stop{false};
+  std::atomic<std::size_t> l_broadcasts{0}, l_churns{0};
+  std::vector<std::thread> l_workers;
+
+  for (std::size_t t = 0; t < 4; ++t)
+    l_workers.emplace_back([&, t] {
+      for (std::size_t i = 0; !l_stop; ++i, ++l_broadcasts)
+      {
+        l_people[(t + i) % l_members]->say("still there?");
+        l_people[(t + i) % l_members]->pm("churn" + std::to_string(i % 4) + "-0", "hi");
+      }
+    });
+  for (std::size_t t = 0; t < 4; ++t)
+    l_workers.emplace_back([&, t] {
+      for (std::size_t i = 0; !l_stop; ++i, ++l_churns)
+      {
+        Person l_visitor{"churn" + std::to_string(t) + "-" + std::to_string(i % 8), l_room};
+        l_visitor.say("just passing by");
+      }
+    });
+
+  std::this_thread::sleep_for(l_duration);
+  l_stop = true;
+  for (auto& l_worker : l_workers)
+    l_worker.join();
+
+  const bool l_ok = l_room.size() == l_members;
+  release(l_people);
+  std::printf("stress     broadcasts=%zu join/leave=%zu members=%s\n",
+              l_broadcasts.load(), l_churns.load(), l_ok ? "consistent" : "CORRUPTED");
+  if ( !l_ok ) std::exit(EXIT_FAILURE);
+}
+
+/*!
+ * @brief Latency of say() as seen by the sender, with synchronous
+ *        delivery and with each backpressure policy of async delivery.
+ */
+void benchAsyncDelivery()
+{
+  const std::size_t l_members = 1000;
+  const std::size_t l_says    = 2000;
+
+  struct Mode
+  {
+    const char*  name;
+    bool         async;
+    Backpressure policy;
+  };
+  const Mode l_modes[] =
+  {
+    {"sync",             false, Backpressure::Block     },
+    {"async/block",      true,  Backpressure::Block     },
+    {"async/dropOldest", true,  Backpressure::DropOldest},
+    {"async/reject",     true,  Backpressure::Reject    },
+  };
+
+  for (const auto& l_mode : l_modes)
+  {
+    MuteCout     l_mute;
+    DeliveryPool l_pool{4};
+    ChatRoom     l_room{false};
+
+    std::vector<std::unique_ptr<Person>> l_people;
+    for (std::size_t i = 0; i < l_members; ++i)
+    {
+      const std::string l_name = "user" + std::to_string(i);
+      l_people.emplace_back(l_mode.async ? std::make_unique<Person>(l_name, l_room, l_pool, 256, l_mode.policy)
+                                         : std::make_unique<Person>(l_name, l_room));
+    }
+
+    std::vector<double> l_latencies;
+    l_latencies.reserve(l_says);
+    for (std::size_t i = 0; i < l_says; ++i)
+    {
+      auto l_start = Clock::now();
+      l_people[i % l_members]->say("hello everyone");
+      l_latencies.push_back(elapsedNs(l_start, 1) / 1e3);
+    }
+
+    uint64_t l_dropped = 0;
+    for (const auto& p : l_people)
+      l_dropped += p->dropped();
+    release(l_people);
+
+    std::printf("%-16s members=%zu p50=%8.1f us  p99=%8.1f us  dropped=%llu\n",
+                l_mode.name, l_members, percentile(l_latencies, .5), percentile(l_latencies, .99),
+                static_cast<unsigned long long>(l_dropped));
+  }
+}
+
+/*!
+ * @brief Heap allocations per broadcast and heap bytes kept
+ *        alive by the chat logs, per million delivered messages.
+ */
+void benchAllocations()
+{
+  const std::size_t l_members = 100;
+  const std::size_t l_says    = 10000;
+  const std::string l_text(64, 'x');
+
+  MuteCout l_mute;
+  ChatRoom l_room{false};
+  auto     l_people = populate(l_room, l_members);
+
+  const uint64_t l_allocs = allocations();
+  const int64_t  l_live   = liveBytes();
+  for (std::size_t i = 0; i < l_says; ++i)
+    l_people[i % l_members]->say(l_text);
+  const double l_perBroadcast = static_cast<double>(allocations() - l_allocs) / l_says;
+  const double l_deliveries   = static_cast<double>(l_says * (l_members - 1));
+  const double l_residentMiB  = static_cast<double>(liveBytes() - l_live) / l_deliveries * 1e6 / (1 << 20);
+
+  release(l_people);
+  std::printf("alloc     members=%zu payload=%zuB  %.1f allocations/broadcast  %.1f MiB resident/1M messages\n",
+              l_members, l_text.size(), l_perBroadcast, l_residentMiB);
+}
+
+/*!
+ * @brief Heap kept alive by the histories while a session runs :
+ *        should not depend on how many messages went through.
+ */
+void benchHistory()
+{
+  const std::size_t l_members = 100;
+  const std::string l_text(64, 'x');
+
+  MuteCout l_mute;
+  ChatRoom l_room{false};
+  l_room.setHistoryCapacity(128);
+  auto     l_people = populate(l_room, l_members);
+
+  const int64_t l_live = liveBytes();
+  std::size_t   l_says = 0;
+  for (std::size_t l_target : {1000u, 10000u, 100000u})
+  {
+    for (; l_says < l_target; ++l_says)
+      l_people[l_says % l_members]->say(l_text);
+    std::printf("history   members=%zu capacity=%zu deliveries=%-9zu %8.1f KiB resident\n",
+                l_members, l_room.historyCapacity(), l_says * (l_members - 1),
+                static_cast<double>(liveBytes() - l_live) / 1024.);
+  }
+  release(l_people);
+}
+
+/*!
+ * @brief Journal append throughput for several group-commit
+ *        sizes, then replay speed of a 10M messages journal.
+ */
+void benchJournal()
+{
+  const auto        l_path = std::filesystem::temp_directory_path() / "mediator-bench.journal";
+  const std::string l_text(64, 'x');
+
+  for (std::size_t l_group : {16u, 256u, 4096u, 65536u})
+  {
+    std::filesystem::remove(l_path);
+    const std::size_t l_records = 1000 * l_group < 1000000 ? 1000 * l_group : 1000000;
+
+    Journal l_journal{l_path.string(), l_group};
+    auto    l_start = Clock::now();
+    for (std::size_t i = 0; i < l_records; ++i)
+      l_journal.append(Journal::Event::Broadcast, "user42", {}, l_text);
+    l_journal.commit();
+    double l_ns = elapsedNs(l_start, l_records);
+
+    std::printf("journal   append group=%-6zu %10.0f records/s  (%zu records)\n",
+                l_group, 1e9 / l_ns, l_records);
+  }
+
+  std::filesystem::remove(l_path);
+  const std::size_t l_records = 10000000;
+  {
+    Journal l_journal{l_path.string(), 0};
+    for (std::size_t i = 0; i < l_records; ++i)
+      l_journal.append(Journal::Event::Broadcast, "user42", {}, l_text);
+  }
+
+  Journal     l_journal{l_path.string(), 0};
+  std::size_t l_bytes = 0;
+  auto        l_start = Clock::now();
+  std::size_t l_count = l_journal.replay([&](const Journal::Record& r) { l_bytes += r.text.size(); });
+  double      l_s     = elapsedNs(l_start, 1) / 1e9;
+
+  std::printf("journal   replay %zu records (%.0f MiB) in %.3f s  %.2f GiB/s\n",
+              l_count, l_journal.size() / double(1 << 20), l_s, l_journal.size() / l_s / double(1 << 30));
+  std::filesystem::remove(l_path);
+}
+
+/*!
+ * @brief Topic routing : 10k topics, 100 subscribers per topic on average.
+ *        'resolve' only walks the subscription index, 'publish' also
+ *        delivers to the Persons.
+ */
+void benchTopics()
+{
+  const std::size_t l_topics    = 10000;
+  const std::size_t l_members   = 10000;
+  const std::size_t l_perMember = 100;   // => average fan-out of 100
+
+  MuteCout    l_mute;
+  ChatRoom    l_room{false};
+  TopicRouter l_router;
+  auto        l_people = populate(l_room, l_members);
+
+  std::vector<TopicRouter::TopicId> l_ids;
+  for (std::size_t t = 0; t < l_topics; ++t)
+    l_ids.push_back(l_router.topic("topic" + std::to_string(t)));
+
+  std::mt19937 l_rng{42};
+  std::uniform_int_distribution<std::size_t> l_pick{0, l_topics - 1};
+  for (auto& p : l_people)
+    for (std::size_t i = 0; i < l_perMember; ++i)
+      l_router.subscribe(p.get(), l_ids[l_pick(l_rng)]);
+
+  const std::size_t l_ops = 1000000;
+  std::size_t       l_deliveries = 0;
+  auto l_start = Clock::now();
+  for (std::size_t i = 0; i < l_ops; ++i)
+    l_router.resolve(&l_ids[i % l_topics], 1, nullptr, [&](Person*) { ++l_deliveries; });
+  double l_ns = elapsedNs(l_start, l_ops);
+  std::printf("topics    resolve            %8.2f M msgs/s  fan-out %.1f\n",
+              1e3 / l_ns, double(l_deliveries) / l_ops);
+
+  const TopicRouter::TopicId l_three[] = {l_ids[1], l_ids[2], l_ids[3]};
+  l_deliveries = 0;
+  l_start = Clock::now();
+  for (std::size_t i = 0; i < l_ops; ++i)
+    l_router.resolve(l_three, 3, nullptr, [&](Person*) { ++l_deliveries; });
+  l_ns = elapsedNs(l_start, l_ops);
+  std::printf("topics    resolve 3 topics   %8.2f M msgs/s  fan-out %.1f (deduplicated)\n",
+              1e3 / l_ns, double(l_deliveries) / l_ops);
+
+  const std::size_t l_publishes = 100000;
+  auto              l_msg       = Message::create("bench", "news");
+  l_deliveries = 0;
+  l_start = Clock::now();
+  for (std::size_t i = 0; i < l_publishes; ++i)
+    l_deliveries += l_router.publish(l_ids[i % l_topics], l_msg);
+  l_ns = elapsedNs(l_start, l_publishes);
+  std::printf("topics    publish            %8.2f M msgs/s  %.1f ns/delivery\n",
+              1e3 / l_ns, l_ns * l_publishes / l_deliveries);
+
+  for (auto& p : l_people)
+    l_router.unsubscribe(p.get());
+  release(l_people);
+}
+
+/*!
+ * @brief Per-message cost of batched broadcasts.
+ */
+void benchBatchBroadcast()
+{
+  const std::size_t l_members  = 1000;
+  const std::size_t l_messages = 4096;
+
+  MuteCout l_mute;
+  ChatRoom l_room{false};
+  auto     l_people = populate(l_room, l_members);
+
+  for (bool l_coalesce : {false, true})
+    for (std::size_t l_size : {1u, 16u, 256u})
+    {
+      std::vector<std::string> l_lines(l_size, "beep boop");
+      auto l_start = Clock::now();
+      for (std::size_t i = 0; i < l_messages / l_size; ++i)
+        l_people[0]->say(l_lines, l_coalesce);
+      double l_ns = elapsedNs(l_start, l_messages);
+
+      std::printf("batch     members=%zu size=%-4zu coalesce=%d %10.1f ns/message\n",
+                  l_members, l_size, l_coalesce, l_ns);
+    }
+  release(l_people);
+}
+
+/*!
+ * @brief Delivery throughput depending on the output sink, all of them
+ *        writing to /dev/null, from 1 and 4 broadcasting threads.
+ */
+void benchSinks()
+{
+  const std::size_t l_members    = 1000;
+  const std::size_t l_broadcasts = 400;
+
+  std::ofstream l_devNull{"/dev/null"};
+  const int     l_fd = ::open("/dev/null", O_WRONLY);
+
+  for (std::size_t l_threads : {1u, 4u})
+  {
+    for (int l_kind = 0; l_kind < 3; ++l_kind)
+    {
+      std::unique_ptr<ISink> l_sink;
+      const char*            l_name;
+      switch ( l_kind )
+      {
+      case 0:  l_sink = std::make_unique<StreamSink>  (l_devNull); l_name = "stream";   break;
+      case 1:  l_sink = std::make_unique<BufferedSink>(l_fd);      l_name = "buffered"; break;
+      default: l_sink = std::make_unique<NullSink>    ();          l_name = "null";     break;
+      }
+
+      ConcurrentChatRoom l_room{0, false};
+      l_room.setSink(*l_sink);
+      auto l_people = populate(l_room, l_members);
+
+      std::vector<std::thread> l_workers;
+      auto l_start = Clock::now();
+      for (std::size_t t = 0; t < l_threads; ++t)
+        l_workers.emplace_back([&, t] {
+          for (std::size_t i = t; i < l_broadcasts; i += l_threads)
+            l_people[i % l_members]->say("hello everyone");
+        });
+      for (auto& l_worker : l_workers)
+        l_worker.join();
+      l_sink->flush();
+      double l_ns = elapsedNs(l_start, l_broadcasts * (l_members - 1));
+
+      release(l_people);
+      std::printf("sink      %-8s threads=%zu %8.2f M deliveries/s\n", l_name, l_threads, 1e3 / l_ns);
+    }
+  }
+  ::close(l_fd);
+}
+
+/*!
+ * @brief Cost of a member leaving and joining again, in rooms
+ *        of different sizes.
+ */
+void benchChurn()
+{
+  for (std::size_t l_members : {10000u, 100000u})
+  {
+    NullSink l_sink;
+    ChatRoom l_room{false};
+    l_room.setSink(l_sink);
+    auto     l_people = populate(l_room, l_members);
+
+    const std::size_t l_ops = 20000;
+    std::mt19937 l_rng{42};
+    std::uniform_int_distribution<std::size_t> l_pick{0, l_members - 1};
+
+    auto l_start = Clock::now();
+    for (std::size_t i = 0; i < l_ops; ++i)
+    {
+      const std::size_t l_who = l_pick(l_rng);
+      l_people[l_who].reset();
+      l_people[l_who] = std::make_unique<Person>("user" + std::to_string(l_who), l_room);
+    }
+    double l_ns = elapsedNs(l_start, l_ops);
+
+    release(l_people);
+    std::printf("churn     members=%-7zu %10.1f ns/leave+join\n", l_members, l_ns);
+  }
+
+  // Announced churn : every notice walks the room, unless they are deferred
+  // and folded into the next broadcast (one every 64 churns here).
+  for (bool l_deferred : {false, true})
+  {
+    const std::size_t l_members = 2000;
+    NullSink l_sink;
+    ChatRoom l_room{true};
+    l_room.setSink(l_sink);
+    auto     l_people = populate(l_room, l_members);
+    l_room.setDeferredNotices(l_deferred);
+
+    const std::size_t l_ops = 2000;
+    std::mt19937 l_rng{42};
+    std::uniform_int_distribution<std::size_t> l_pick{0, l_members - 1};
+
+    auto l_start = Clock::now();
+    for (std::size_t i = 0; i < l_ops; ++i)
+    {
+      const std::size_t l_who = l_pick(l_rng);
+      l_people[l_who].reset();
+      l_people[l_who] = std::make_unique<Person>("user" + std::to_string(l_who), l_room);
+      if ( i % 64 == 63 ) l_people[l_who]->say("hello");
+    }
+    l_room.flushNotices();
+    double l_ns = elapsedNs(l_start, l_ops);
+
+    release(l_people);
+    std::printf("churn     members=%-7zu %10.1f ns/leave+join (announced, %s notices)\n",
+                l_members, l_ns, l_deferred ? "deferred" : "immediate");
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  const std::vector<std::pair<std::string, std::function<void()>>> l_scenarios =
+  {
+    {"pm",        benchPrivateMessages},
+    {"broadcast", benchBroadcast      },
+    {"concurrent", benchConcurrentBroadcast},
+    {"stress",     stressConcurrentChurn   },
+    {"async",      benchAsyncDelivery      },
+    {"alloc",      benchAllocations        },
+    {"history",    benchHistory            },
+    {"journal",    benchJournal            },
+    {"topics",     benchTopics             },
+    {"batch",      benchBatchBroadcast     },
+    {"sink",       benchSinks              },
+    {"churn",      benchChurn              },
+  };
+
+  for (const auto& l_scenario : l_scenarios)
+  {
+    bool l_selected = argc < 2;
+    for (int i = 1; i < argc; ++i)
+      l_selected |= l_scenario.first == argv[i];
+    if ( l_selected )
+      l_scenario.second();
+  }
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "BufferedSink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+#include <unistd.h>
+
+namespace {
+
+std::atomic<uint64_t> g_sinkIds{0};
+
+} // namespace
+
+BufferedSink::BufferedSink(int p_fd, std::size_t p_threshold, std::chrono::milliseconds p_interval,
+                           std::size_t p_capacity) :
+m_id(++g_sinkIds), m_fd(p_fd), m_threshold(p_threshold), m_interval(p_interval),
+m_capacity(std::max(p_capacity, p_threshold)),
+m_flusher(&BufferedSink::run, this)
+{
+}
+
+BufferedSink::~BufferedSink()
+{
+  {
+    std::lock_guard<std::mutex> l_lock(m_wakeMutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_flusher.join();
+  flush();
+}
+
+BufferedSink::Buffer& BufferedSink::local(void)
+{
+  // Each thread remembers its buffer in every sink it wrote to.
+  thread_local std::vector<CacheEntry> l_cache;
+  for (const auto& l_entry : l_cache)
+    if ( l_entry.sink == m_id ) return *l_entry.buffer;
+
+  // Forget the buffers of the sinks destroyed since.
+  l_cache.erase(std::remove_if(std::begin(l_cache), std::end(l_cache),
+                               [](const CacheEntry& e) { return e.owner.expired(); }),
+                std::end(l_cache));
+
+  // Not make_shared : the weak references would keep the whole Buffer allocated.
+  std::shared_ptr<Buffer> l_buffer{new Buffer};
+  {
+    std::lock_guard<std::mutex> l_lock(m_buffersMutex);
+    m_buffers.push_back(l_buffer);
+  }
+  l_cache.push_back({m_id, l_buffer.get(), l_buffer});
+  return *l_buffer;
+}
+
+void BufferedSink::write(const Person&, const Message &p_msg)
+{
+  Buffer& l_buffer = local();
+  l_buffer.lock();
+  format(l_buffer.data, p_msg);
+  const std::size_t l_size = l_buffer.data.size();
+  l_buffer.unlock();
+
+  if ( l_size >= m_capacity )
+  {
+    flush(); // The flusher is behind : do its job rather than grow
+  }
+  else if ( l_size >= m_threshold && !m_urgent.load() )
+  {
+    // Under the lock, so that the flusher cannot miss it between its check and its wait.
+    std::lock_guard<std::mutex> l_lock(m_wakeMutex);
+    m_urgent = true;
+    m_wake.notify_one();
+  }
+}
+
+void BufferedSink::flush(void)
+{
+  std::lock_guard<std::mutex> l_flush(m_flushMutex);
+  {
+    std::lock_guard<std::mutex> l_lock(m_buffersMutex);
+    for (auto& l_buffer : m_buffers)
+    {
+      l_buffer->lock();
+      m_pending.append(l_buffer->data);
+      l_buffer->data.clear();
+      l_buffer->unlock();
+    }
+  }
+
+  const char* l_data = m_pending.data();
+  std::size_t l_left = m_pending.size();
+  while ( l_left )
+  {
+    ssize_t l_written = ::write(m_fd, l_data, l_left);
+    if ( l_written < 0 )
+    {
+      if ( errno == EINTR ) continue;
+      break; // Nowhere to report it : drop the output rather than spin
+    }
+    l_data += l_written;
+    l_left -= static_cast<std::size_t>(l_written);
+  }
+  m_pending.clear();
+}
+
+void BufferedSink::run(void)
+{
+  std::unique_lock<std::mutex> l_lock(m_wakeMutex);
+  while ( !m_stop )
+  {
+    m_wake.wait_for(l_lock, m_interval, [this] { return m_stop || m_urgent.load(); });
+    m_urgent = false;
+
+    l_lock.unlock();
+    flush();
+    l_lock.lock();
+  }
+}
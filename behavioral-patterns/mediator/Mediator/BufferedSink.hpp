@@ -0,0 +1,93 @@
+#ifndef  BUFFEREDSINK_H
+#define BUFFEREDSINK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Sink.hpp"
+
+/*!
+ * @brief BufferedSink
+ *        Formats messages into a buffer owned by the writing thread, and
+ *        lets a background thread hand all the buffers to the kernel with
+ *        one large write(2) every p_interval (or sooner when a buffer
+ *        exceeds p_threshold bytes). A writer whose buffer reaches
+ *        p_capacity bytes flushes it itself, so memory stays bounded
+ *        when the output falls behind.
+ *
+ *        A writer only takes the spin lock of its own buffer, which is
+ *        contended by the flusher alone, for as long as a swap takes.
+ *        Lines written by a given thread keep their order. Lines from
+ *        different threads may interleave by batches.
+ */
+class BufferedSink : public ISink
+{
+  public:
+    explicit BufferedSink(int                       p_fd        = 1,
+                          std::size_t               p_threshold = 1 << 16,
+                          std::chrono::milliseconds p_interval  = std::chrono::milliseconds(10),
+                          std::size_t               p_capacity  = 1 << 22);
+    ~BufferedSink();
+
+    BufferedSink(const BufferedSink&)            = delete;
+    BufferedSink& operator=(const BufferedSink&) = delete;
+
+    void write(const Person &p_to, const Message &p_msg) override;
+
+    /*!
+     * @brief Writes out everything buffered so far before returning.
+     */
+    void flush(void) override;
+
+  private:
+    struct Buffer
+    {
+      void lock  (void) { while ( busy.test_and_set(std::memory_order_acquire) ) std::this_thread::yield(); }
+      void unlock(void) { busy.clear(std::memory_order_release); }
+
+      std::atomic_flag busy = ATOMIC_FLAG_INIT;
+      std::string      data;
+    };
+
+    /*!
+     * @brief What a thread remembers of the buffer it owns in a sink.
+     *        Weak : the buffer goes away with the sink, and the entry
+     *        is pruned on the next miss.
+     */
+    struct CacheEntry
+    {
+      uint64_t              sink;
+      Buffer*               buffer;  /*!< Valid as long as the sink is */
+      std::weak_ptr<Buffer> owner;
+    };
+
+    Buffer& local(void);
+    void    run  (void);
+
+    const uint64_t                       m_id;        /*!< Tells sinks apart in the thread caches */
+    const int                            m_fd;
+    const std::size_t                    m_threshold;
+    const std::chrono::milliseconds      m_interval;
+    const std::size_t                    m_capacity;
+
+    std::mutex                           m_buffersMutex;
+    std::vector<std::shared_ptr<Buffer>> m_buffers;
+
+    std::mutex                           m_flushMutex; /*!< One flush at a time */
+    std::string                          m_pending;    /*!< Reused between flushes */
+
+    std::mutex                           m_wakeMutex;
+    std::condition_variable              m_wake;
+    std::atomic<bool>                    m_urgent{false}; /*!< Set under m_wakeMutex */
+    bool                                 m_stop{false};
+    std::thread                          m_flusher;
+};
+
+#endif // BUFFEREDSINK_H
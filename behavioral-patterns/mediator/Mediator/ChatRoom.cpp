@@ -1,40 +1,206 @@
-#include "person.hpp"
+#include "Person.hpp"
 #include "ChatRoom.hpp"
 #include <algorithm>
 
-void ChatRoom::broadcast(const std::string& p_from, const std::string& p_msg )
+ChatRoom::ParticipantId ChatRoom::intern(const std::string &p_name)
 {
-  for (auto& p : m_people)
-    if ( p->getName() != p_from ) p->receive(p_from, p_msg);
+  auto l_res = m_ids.emplace(p_name, kNoParticipant);
+  if ( l_res.second )
+  {
+    if ( m_free.empty() )
+    {
+      l_res.first->second = static_cast<ParticipantId>(m_byId.size());
+      m_byId  .push_back(nullptr);
+      m_counts.push_back(0);
+    }
+    else
+    {
+      l_res.first->second = m_free.back();
+      m_free.pop_back();
+    }
+  }
+  return l_res.first->second;
+}
+
+ChatRoom::ParticipantId ChatRoom::lookup(const std::string &p_name) const
+{
+  auto l_it = m_ids.find(p_name);
+  return l_it != std::end(m_ids) ? l_it->second : kNoParticipant;
+}
+
+void ChatRoom::announce(std::string p_text)
+{
+  auto l_notice = Message::create("room", std::move(p_text));
+  if ( m_deferNotices )
+    m_notices.push_back(std::move(l_notice));
+  else
+    broadcast(l_notice);
+}
+
+void ChatRoom::flushNotices()
+{
+  if ( m_notices.empty() ) return;
+
+  std::vector<MessagePtr> l_batch;
+  l_batch.swap(m_notices);
+  broadcast(l_batch);
+}
+
+void ChatRoom::broadcast(const MessagePtr& p_msg )
+{
+  if ( !m_notices.empty() )
+  {
+    m_notices.push_back(p_msg);
+    flushNotices();
+    return;
+  }
+
+  if ( m_journal )
+    m_journal->append(Journal::Event::Broadcast, p_msg->from(), {}, p_msg->text());
+
+  const ParticipantId l_from = lookup(p_msg->from());
+  for (auto& m : m_people)
+    if ( m.id != l_from ) m.person->receive(p_msg);
+}
+
+void ChatRoom::broadcast(const std::vector<MessagePtr>& p_batch )
+{
+  if ( !m_notices.empty() )
+  {
+    m_notices.insert(std::end(m_notices), std::begin(p_batch), std::end(p_batch));
+    flushNotices();
+    return;
+  }
+
+  // Senders of the batch (usually a single one) get it without their own messages.
+  std::vector<ParticipantId> l_from, l_senders;
+  l_from.reserve(p_batch.size());
+  for (const auto& l_msg : p_batch)
+  {
+    if ( m_journal )
+      m_journal->append(Journal::Event::Broadcast, l_msg->from(), {}, l_msg->text());
+
+    l_from.push_back(lookup(l_msg->from()));
+    if ( std::find(std::begin(l_senders), std::end(l_senders), l_from.back()) == std::end(l_senders) )
+      l_senders.push_back(l_from.back());
+  }
+
+  std::vector<MessagePtr> l_filtered;
+  for (auto& m : m_people)
+  {
+    if ( std::find(std::begin(l_senders), std::end(l_senders), m.id) == std::end(l_senders) )
+    {
+      m.person->receive(p_batch.data(), p_batch.size());
+      continue;
+    }
+
+    l_filtered.clear();
+    for (std::size_t i = 0; i < p_batch.size(); ++i)
+      if ( l_from[i] != m.id ) l_filtered.push_back(p_batch[i]);
+    if ( !l_filtered.empty() )
+      m.person->receive(l_filtered.data(), l_filtered.size());
+  }
 }
 
 void ChatRoom::join( Person* p )
 {
-  std::string join_msg = p->getName() + " joins the chat";
-  broadcast( "room", join_msg );
-  m_people.push_back( p );
+  if ( m_announce )
+    announce( p->getName() + " joins the chat" );
+
+  if ( m_journal )
+    m_journal->append(Journal::Event::Join, p->getName(), {}, {});
+
+  p->m_id = intern( p->getName() );
+  if ( m_counts[p->m_id]++ == 0 )
+    m_byId[p->m_id] = p;
+  p->m_slot = m_people.size();
+  m_people.push_back( {p->m_id, p} );
 }
 
 void ChatRoom::leave( Person* p )
 {
-  std::string leave_msg = p->getName() + " left the chat";
-  broadcast( "room", leave_msg );
-  m_people.erase ( 
-    std::remove( std::begin(m_people), std::end   (m_people), p ), std::end(m_people) );
+  // Not a member (anymore) : nothing to do.
+  if ( p->m_slot >= m_people.size() || m_people[p->m_slot].person != p )
+    return;
+
+  if ( m_announce )
+    announce( p->getName() + " left the chat" );
+
+  if ( m_journal )
+    m_journal->append(Journal::Event::Leave, p->getName(), {}, {});
+
+  // Swap-remove : the last member takes the slot.
+  m_people[p->m_slot] = m_people.back();
+  m_people[p->m_slot].person->m_slot = p->m_slot;
+  m_people.pop_back();
+
+  const ParticipantId l_id = p->m_id;
+  if ( --m_counts[l_id] == 0 )
+  {
+    m_byId[l_id] = nullptr;
+    m_ids.erase(p->getName());
+    m_free.push_back(l_id);
+  }
+  else if ( m_byId[l_id] == p )
+  {
+    // Homonyms share an identifier : hand the PM slot over to another one.
+    m_byId[l_id] = std::find_if(
+        std::begin(m_people),
+        std::end(m_people),
+        [l_id](const Member& m) { return m.id == l_id; })->person;
+  }
+  p->m_id = kNoParticipant;
+}
+
+void ChatRoom::replay(const Journal &p_journal)
+{
+  Journal* l_journal = m_journal;
+  m_journal = nullptr;
+
+  std::vector<uint32_t> l_present(m_byId.size(), 0); // id -> members with that name at that time
+  auto l_id = [this](std::string_view p_name) {
+    return lookup(std::string(p_name));
+  };
+
+  p_journal.replay([&](const Journal::Record& p_record) {
+    const ParticipantId l_from = l_id(p_record.from);
+    switch ( p_record.event )
+    {
+    case Journal::Event::Join:
+      if ( l_from != kNoParticipant ) ++l_present[l_from];
+      break;
+    case Journal::Event::Leave:
+      if ( l_from != kNoParticipant && l_present[l_from] ) --l_present[l_from];
+      break;
+    case Journal::Event::Broadcast:
+      {
+        auto l_msg = Message::create(std::string(p_record.from), std::string(p_record.text));
+        for (auto& m : m_people)
+          if ( m.id != l_from && l_present[m.id] ) m.person->receive(l_msg);
+      }
+      break;
+    case Journal::Event::Message:
+      {
+        const ParticipantId l_to = l_id(p_record.to);
+        if ( l_to != kNoParticipant && l_present[l_to] && m_byId[l_to] )
+          m_byId[l_to]->receive(Message::create(std::string(p_record.from), std::string(p_record.text)));
+      }
+      break;
+    }
+  });
+
+  m_journal = l_journal;
 }
 
-void ChatRoom::message(const std::string &p_from,
-             const std::string &p_to,
-             const std::string &p_msg)
+void ChatRoom::message(const std::string &p_to,
+             const MessagePtr  &p_msg)
 {
-  auto target = std::find_if(
-      std::begin(m_people),
-      std::end(m_people),
-      [&](const Person* p) {
-        return p->getName() == p_to;
-      });
-  if (target != std::end(m_people))
+  if ( m_journal )
+    m_journal->append(Journal::Event::Message, p_msg->from(), p_to, p_msg->text());
+
+  const ParticipantId l_to = lookup(p_to);
+  if ( l_to != kNoParticipant && m_byId[l_to] )
   {
-    (*target)->receive(p_from, p_msg);
+    m_byId[l_to]->receive(p_msg);
   }
-}
\ No newline at end of file
+}
@@ -1,28 +1,104 @@
 #ifndef  CHATROOM_H
 #define CHATROOM_H
 
-#include <memory>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
-class ChatRoom
+#include "IChatRoom.hpp"
+#include "Journal.hpp"
+
+/*!
+ * @brief ChatRoom
+ *        Concrete mediator : routes messages between the
+ *        Persons that joined it.
+ *
+ *        Names are interned into dense integer identifiers on join,
+ *        so that private messages are resolved with a single hash
+ *        lookup and broadcasts skip the sender by integer compare.
+ *        Identifiers are recycled once nobody uses the name anymore.
+ *
+ *        Each Person knows its slot in the membership array : leaving
+ *        moves the last member into that slot, so join and leave are O(1).
+ *        Members are therefore not walked in join order.
+ */
+class ChatRoom : public IChatRoom
 {
   public:
-    ChatRoom() = default;
+    using ParticipantId = uint32_t;
+    static constexpr ParticipantId kNoParticipant = UINT32_MAX;
+
+    /*!
+     * @param p_announce Broadcast a notice when someone joins/leaves.
+     */
+    explicit ChatRoom(bool p_announce = true) : m_announce(p_announce) {}
     ~ChatRoom() = default;
 
-    void broadcast(const std::string &p_from,
-                            const std::string &p_msg);
+    void broadcast(const MessagePtr &p_msg) override;
+
+    void broadcast(const std::vector<MessagePtr> &p_batch) override;
+
+    void join  ( Person* p ) override;
+
+    void leave( Person* p ) override;
 
-    void join  ( Person* p );
+    void message(const std::string &p_to,
+                           const MessagePtr  &p_msg) override;
 
-    void leave( Person* p );
+    std::size_t size() const { return m_people.size(); }
 
-    void message(const std::string &p_from,
-                           const std::string &p_to,
-                           const std::string &p_msg);
+    /*!
+     * @brief When set, join/leave notices are not broadcast on their own
+     *        but along with the next broadcast (or flushNotices()), in a
+     *        single walk of the membership. The Person a notice is about
+     *        may then receive it too.
+     */
+    void setDeferredNotices(bool p_deferred) { m_deferNotices = p_deferred; }
+
+    /*!
+     * @brief Broadcasts the deferred notices now.
+     */
+    void flushNotices();
+
+    /*!
+     * @brief Records every join/leave/broadcast/message routed from now on
+     *        into p_journal (nullptr to stop). The journal must outlive the room.
+     */
+    void setJournal(Journal* p_journal) { m_journal = p_journal; }
+
+    /*!
+     * @brief Re-delivers the journaled messages to the current members that
+     *        were in the room when they were sent, e.g. to refill their
+     *        histories at startup. Nothing is journaled while replaying.
+     */
+    void replay(const Journal &p_journal);
 
   private:
-    std::vector<Person*> m_people;
+    /*!
+     * @brief Member
+     *        Keeps the identifier next to the pointer so that
+     *        walking the membership does not touch the Persons.
+     */
+    struct Member
+    {
+      ParticipantId id;
+      Person*       person;
+    };
+
+    ParticipantId intern(const std::string &p_name);
+    ParticipantId lookup(const std::string &p_name) const;
+    void          announce(std::string p_text);
+
+    bool                                           m_announce;
+    bool                                           m_deferNotices{false};
+    std::vector<MessagePtr>                        m_notices;  /*!< Deferred join/leave notices */
+    Journal*                                       m_journal{nullptr};
+    std::vector<Member>                            m_people;
+    std::unordered_map<std::string, ParticipantId> m_ids;      /*!< name -> id                  */
+    std::vector<Person*>                           m_byId;     /*!< id   -> PM target           */
+    std::vector<uint32_t>                          m_counts;   /*!< id   -> members with it     */
+    std::vector<ParticipantId>                     m_free;     /*!< Recyclable ids              */
 };
 
 #endif // CHATROOM_H
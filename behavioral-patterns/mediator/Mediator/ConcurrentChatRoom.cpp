@@ -0,0 +1,156 @@
+#include "Person.hpp"
+#include "ConcurrentChatRoom.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+ConcurrentChatRoom::ReadGuard::ReadGuard(const Shard& p_shard) :
+m_shard(p_shard), m_parity(p_shard.epoch.load() & 1)
+{
+  // Registering before loading the snapshot guarantees that a writer either
+  // waits for us or has already published the snapshot we are about to load.
+  m_shard.readers[m_parity].fetch_add(1);
+  m_snapshot = m_shard.snapshot.load();
+}
+
+ConcurrentChatRoom::ReadGuard::~ReadGuard()
+{
+  m_shard.readers[m_parity].fetch_sub(1);
+}
+
+ConcurrentChatRoom::ConcurrentChatRoom(std::size_t p_shards, bool p_announce) :
+m_announce(p_announce),
+m_shards(p_shards ? p_shards : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+ConcurrentChatRoom::~ConcurrentChatRoom()
+{
+  for (auto& l_shard : m_shards)
+    delete l_shard.snapshot.load();
+}
+
+void ConcurrentChatRoom::publish(Shard& p_shard, const Snapshot* p_next)
+{
+  const Snapshot* l_old = p_shard.snapshot.exchange(p_next);
+
+  // Two flips : a reader may have sampled the epoch just before the
+  // previous grace period and be registered under either parity.
+  for (int i = 0; i < 2; ++i)
+  {
+    const uint64_t l_parity = p_shard.epoch.fetch_add(1) & 1;
+    while ( p_shard.readers[l_parity].load() != 0 )
+      std::this_thread::yield();
+  }
+
+  delete l_old;
+}
+
+void ConcurrentChatRoom::broadcast(const MessagePtr &p_msg)
+{
+  const std::string& l_name = p_msg->from();
+  const std::size_t  l_from = std::hash<std::string>{}(l_name);
+  for (auto& l_shard : m_shards)
+  {
+    ReadGuard l_guard(l_shard);
+    for (const auto& m : l_guard.snapshot().members)
+      if ( m.hash != l_from || m.person->getName() != l_name )
+        m.person->receive(p_msg);
+  }
+}
+
+void ConcurrentChatRoom::broadcast(const std::vector<MessagePtr> &p_batch)
+{
+  std::vector<std::size_t> l_from, l_senders;
+  l_from.reserve(p_batch.size());
+  for (const auto& l_msg : p_batch)
+  {
+    l_from.push_back(std::hash<std::string>{}(l_msg->from()));
+    if ( std::find(std::begin(l_senders), std::end(l_senders), l_from.back()) == std::end(l_senders) )
+      l_senders.push_back(l_from.back());
+  }
+
+  std::vector<MessagePtr> l_filtered;
+  for (auto& l_shard : m_shards)
+  {
+    ReadGuard l_guard(l_shard);
+    for (const auto& m : l_guard.snapshot().members)
+    {
+      if ( std::find(std::begin(l_senders), std::end(l_senders), m.hash) == std::end(l_senders) )
+      {
+        m.person->receive(p_batch.data(), p_batch.size());
+        continue;
+      }
+
+      l_filtered.clear();
+      for (std::size_t i = 0; i < p_batch.size(); ++i)
+        if ( l_from[i] != m.hash || p_batch[i]->from() != m.person->getName() )
+          l_filtered.push_back(p_batch[i]);
+      if ( !l_filtered.empty() )
+        m.person->receive(l_filtered.data(), l_filtered.size());
+    }
+  }
+}
+
+void ConcurrentChatRoom::join(Person* p)
+{
+  if ( m_announce )
+    broadcast( Message::create("room", p->getName() + " joins the chat") );
+
+  const std::size_t l_hash  = std::hash<std::string>{}(p->getName());
+  Shard&            l_shard = shardOf(l_hash);
+
+  std::lock_guard<std::mutex> l_lock(l_shard.writer);
+  auto* l_next = new Snapshot(*l_shard.snapshot.load());
+  l_next->members.push_back({l_hash, p});
+  l_next->byName.emplace(p->getName(), p);
+  publish(l_shard, l_next);
+}
+
+void ConcurrentChatRoom::leave(Person* p)
+{
+  if ( m_announce )
+    broadcast( Message::create("room", p->getName() + " left the chat") );
+
+  const std::size_t l_hash  = std::hash<std::string>{}(p->getName());
+  Shard&            l_shard = shardOf(l_hash);
+
+  std::lock_guard<std::mutex> l_lock(l_shard.writer);
+  auto* l_next    = new Snapshot(*l_shard.snapshot.load());
+  auto& l_members = l_next->members;
+  l_members.erase(
+    std::remove_if( std::begin(l_members), std::end(l_members),
+                    [p](const Member& m) { return m.person == p; } ),
+    std::end(l_members) );
+
+  // Homonyms live in the same shard : hand the PM slot over to the next one.
+  auto l_slot = l_next->byName.find(p->getName());
+  if ( l_slot != std::end(l_next->byName) && l_slot->second == p )
+  {
+    auto l_homonym = std::find_if(
+        std::begin(l_members), std::end(l_members),
+        [&](const Member& m) { return m.hash == l_hash && m.person->getName() == p->getName(); });
+    if ( l_homonym != std::end(l_members) )
+      l_slot->second = l_homonym->person;
+    else
+      l_next->byName.erase(l_slot);
+  }
+  publish(l_shard, l_next);
+}
+
+void ConcurrentChatRoom::message(const std::string &p_to,
+                                 const MessagePtr  &p_msg)
+{
+  ReadGuard l_guard(shardOf(std::hash<std::string>{}(p_to)));
+  auto l_target = l_guard.snapshot().byName.find(p_to);
+  if ( l_target != std::end(l_guard.snapshot().byName) )
+    l_target->second->receive(p_msg);
+}
+
+std::size_t ConcurrentChatRoom::size() const
+{
+  std::size_t l_size = 0;
+  for (const auto& l_shard : m_shards)
+    l_size += ReadGuard(l_shard).snapshot().members.size();
+  return l_size;
+}
@@ -0,0 +1,109 @@
+#ifndef  CONCURRENTCHATROOM_H
+#define CONCURRENTCHATROOM_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IChatRoom.hpp"
+
+/*!
+ * @brief ConcurrentChatRoom
+ *        Concrete mediator that can be used from several threads.
+ *
+ *        Membership is sharded on the hash of the names. Each shard
+ *        publishes an immutable snapshot of its members (read-copy-update) :
+ *         - broadcast/message only register themselves in the current epoch
+ *           of a shard and read its snapshot : they never take a lock nor
+ *           wait for a writer.
+ *         - join/leave copy the snapshot of a single shard under that
+ *           shard's writer lock, publish the copy, then wait for a grace
+ *           period (every reader that could still see the old snapshot is
+ *           done) before reclaiming it.
+ *
+ *        Once leave() returns, the Person will not be delivered anything
+ *        anymore and can safely be destroyed.
+ */
+class ConcurrentChatRoom : public IChatRoom
+{
+  public:
+    /*!
+     * @param p_shards   Number of shards (defaults to the number of cores).
+     * @param p_announce Broadcast a notice when someone joins/leaves.
+     */
+    explicit ConcurrentChatRoom(std::size_t p_shards   = 0,
+                                bool        p_announce = true);
+    ~ConcurrentChatRoom();
+
+    ConcurrentChatRoom(const ConcurrentChatRoom&)            = delete;
+    ConcurrentChatRoom& operator=(const ConcurrentChatRoom&) = delete;
+
+    void broadcast(const MessagePtr &p_msg) override;
+
+    void broadcast(const std::vector<MessagePtr> &p_batch) override;
+
+    void join ( Person* p ) override;
+
+    void leave( Person* p ) override;
+
+    void message(const std::string &p_to,
+                 const MessagePtr  &p_msg) override;
+
+    std::size_t size() const;
+
+  private:
+    struct Member
+    {
+      std::size_t hash;   /*!< Hash of the name, compared before the name itself */
+      Person*     person;
+    };
+
+    struct Snapshot
+    {
+      std::vector<Member>                      members;
+      std::unordered_map<std::string, Person*> byName;
+    };
+
+    struct alignas(64) Shard
+    {
+      std::mutex                    writer;
+      std::atomic<const Snapshot*>  snapshot{new Snapshot{}};
+      std::atomic<uint64_t>         epoch{0};
+      mutable std::atomic<uint64_t> readers[2]{};
+    };
+
+    /*!
+     * @brief ReadGuard
+     *        Registers a reader in the current epoch of a shard for
+     *        as long as it uses the shard's snapshot.
+     */
+    class ReadGuard
+    {
+      public:
+        explicit ReadGuard(const Shard& p_shard);
+        ~ReadGuard();
+
+        const Snapshot& snapshot() const { return *m_snapshot; }
+
+      private:
+        const Shard&    m_shard;
+        uint64_t        m_parity;
+        const Snapshot* m_snapshot;
+    };
+
+    Shard& shardOf(std::size_t p_hash) { return m_shards[p_hash % m_shards.size()]; }
+
+    /*!
+     * @brief Publishes p_next in p_shard and reclaims the previous snapshot
+     *        once no reader can see it anymore. The writer lock must be held.
+     */
+    void publish(Shard& p_shard, const Snapshot* p_next);
+
+    bool               m_announce;
+    std::vector<Shard> m_shards;
+};
+
+#endif // CONCURRENTCHATROOM_H
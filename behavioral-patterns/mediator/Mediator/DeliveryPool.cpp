@@ -0,0 +1,64 @@
+#include "DeliveryPool.hpp"
+#include "Person.hpp"
+#include <algorithm>
+
+DeliveryPool::DeliveryPool(std::size_t p_workers, std::size_t p_batch) :
+m_batch(std::max<std::size_t>(1, p_batch))
+{
+  if ( !p_workers )
+    p_workers = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t i = 0; i < p_workers; ++i)
+    m_workers.emplace_back(&DeliveryPool::run, this);
+}
+
+DeliveryPool::~DeliveryPool()
+{
+  {
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  for (auto& l_worker : m_workers)
+    l_worker.join();
+}
+
+void DeliveryPool::schedule(Person* p)
+{
+  {
+    std::lock_guard<std::mutex> l_lock(m_mutex);
+    m_ready.push_back(p);
+  }
+  m_cv.notify_one();
+}
+
+void DeliveryPool::quiesce()
+{
+  // A Person with pending messages is either ready or being drained.
+  std::unique_lock<std::mutex> l_lock(m_mutex);
+  m_idle.wait(l_lock, [this] { return m_ready.empty() && m_busy == 0; });
+}
+
+void DeliveryPool::run()
+{
+  for (;;)
+  {
+    Person* l_next;
+    {
+      std::unique_lock<std::mutex> l_lock(m_mutex);
+      m_cv.wait(l_lock, [this] { return m_stop || !m_ready.empty(); });
+      if ( m_ready.empty() ) return; // Stopped and nothing left to deliver
+      l_next = m_ready.front();
+      m_ready.pop_front();
+      ++m_busy;
+    }
+    l_next->drain(m_batch);
+
+    bool l_idle;
+    {
+      std::lock_guard<std::mutex> l_lock(m_mutex);
+      l_idle = --m_busy == 0 && m_ready.empty();
+    }
+    if ( l_idle )
+      m_idle.notify_all();
+  }
+}
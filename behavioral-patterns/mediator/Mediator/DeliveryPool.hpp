@@ -0,0 +1,59 @@
+#ifndef  DELIVERYPOOL_H
+#define DELIVERYPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Person;
+
+/*!
+ * @brief DeliveryPool
+ *        Fixed set of workers draining the mailboxes of the
+ *        Persons using asynchronous delivery.
+ *
+ *        A Person is scheduled when its mailbox goes from empty to
+ *        non-empty, and a worker then hands it up to batch() messages
+ *        before putting it back at the end of the ready queue. A Person is
+ *        never drained by two workers at once, so its messages are
+ *        handled in order.
+ *
+ *        The pool must outlive the Persons it delivers to.
+ */
+class DeliveryPool
+{
+  public:
+    explicit DeliveryPool(std::size_t p_workers = 0,
+                          std::size_t p_batch   = 64);
+    ~DeliveryPool();
+
+    DeliveryPool(const DeliveryPool&)            = delete;
+    DeliveryPool& operator=(const DeliveryPool&) = delete;
+
+    void        schedule(Person* p);
+    std::size_t batch() const { return m_batch; }
+
+    /*!
+     * @brief Waits until there is nothing left to deliver : every message
+     *        posted before the call has been handled. Posts made meanwhile
+     *        may delay it.
+     */
+    void quiesce();
+
+  private:
+    void run();
+
+    const std::size_t        m_batch;
+    std::mutex               m_mutex;
+    std::condition_variable  m_cv;
+    std::condition_variable  m_idle;    /*!< Nothing ready nor being drained */
+    std::deque<Person*>      m_ready;
+    std::size_t              m_busy{0}; /*!< Workers draining a Person       */
+    bool                     m_stop{false};
+    std::vector<std::thread> m_workers;
+};
+
+#endif // DELIVERYPOOL_H
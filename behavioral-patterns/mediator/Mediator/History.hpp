@@ -0,0 +1,133 @@
+#ifndef  HISTORY_H
+#define HISTORY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "Message.hpp"
+
+/*!
+ * @brief History
+ *        Fixed-capacity chat history : once full, each new message
+ *        replaces the oldest one, so its footprint never grows.
+ *
+ *        Entries are references to the shared Messages, stored in one
+ *        contiguous ring allocated up front. Reading goes through
+ *        iterators (oldest first) or the two contiguous segments of the
+ *        ring, none of which copies anything.
+ */
+class History
+{
+  public:
+    /*!
+     * @brief Contiguous run of entries.
+     */
+    struct Segment
+    {
+      const MessagePtr* data;
+      std::size_t       size;
+
+      const MessagePtr* begin() const { return data;        }
+      const MessagePtr* end  () const { return data + size; }
+    };
+
+    class const_iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = MessagePtr;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const MessagePtr*;
+        using reference         = const MessagePtr&;
+
+        const_iterator(const History& p_history, std::size_t p_index) :
+        m_history(&p_history), m_index(p_index) {}
+
+        reference       operator* () const { return (*m_history)[m_index]; }
+        pointer         operator->() const { return &**this; }
+        const_iterator& operator++()       { ++m_index; return *this; }
+        const_iterator  operator++(int)    { auto l_it = *this; ++m_index; return l_it; }
+
+        bool operator==(const const_iterator &p_rhs) const { return m_index == p_rhs.m_index; }
+        bool operator!=(const const_iterator &p_rhs) const { return m_index != p_rhs.m_index; }
+
+      private:
+        const History* m_history;
+        std::size_t    m_index;
+    };
+
+    explicit History(std::size_t p_capacity) : m_ring(p_capacity) {}
+
+    void push(const MessagePtr &p_msg)
+    {
+      if ( m_ring.empty() ) return;
+
+      if ( m_size < m_ring.size() )
+      {
+        m_ring[wrap(m_head + m_size)] = p_msg;
+        ++m_size;
+      }
+      else
+      {
+        m_ring[m_head] = p_msg;
+        m_head         = wrap(m_head + 1);
+      }
+    }
+
+    /*!
+     * @brief Changes the capacity, keeping the most recent entries.
+     */
+    void setCapacity(std::size_t p_capacity)
+    {
+      std::vector<MessagePtr> l_ring(p_capacity);
+      const std::size_t l_kept = std::min(m_size, p_capacity);
+      for (std::size_t i = 0; i < l_kept; ++i)
+        l_ring[i] = std::move(m_ring[wrap(m_head + m_size - l_kept + i)]);
+
+      m_ring.swap(l_ring);
+      m_head = 0;
+      m_size = l_kept;
+    }
+
+    /*!
+     * @brief p_index-th entry, 0 being the oldest one.
+     */
+    const MessagePtr& operator[](std::size_t p_index) const { return m_ring[wrap(m_head + p_index)]; }
+
+    std::size_t size    () const { return m_size;        }
+    std::size_t capacity() const { return m_ring.size(); }
+    bool        empty   () const { return m_size == 0;   }
+
+    const_iterator begin() const { return {*this, 0};      }
+    const_iterator end  () const { return {*this, m_size}; }
+
+    /*!
+     * @brief Oldest part of the history, up to the end of the ring.
+     */
+    Segment first() const
+    {
+      return {m_ring.data() + m_head, std::min(m_size, m_ring.size() - m_head)};
+    }
+
+    /*!
+     * @brief Most recent part of the history, wrapped at the start of the ring.
+     */
+    Segment second() const
+    {
+      return {m_ring.data(), m_size - first().size};
+    }
+
+  private:
+    std::size_t wrap(std::size_t p_index) const
+    {
+      return p_index < m_ring.size() ? p_index : p_index - m_ring.size();
+    }
+
+    std::vector<MessagePtr> m_ring;
+    std::size_t             m_head{0}; /*!< Oldest entry */
+    std::size_t             m_size{0};
+};
+
+#endif // HISTORY_H
@@ -0,0 +1,63 @@
+#ifndef  ICHATROOM_H
+#define ICHATROOM_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Message.hpp"
+#include "Sink.hpp"
+
+class Person;
+
+/*!
+ * @brief IChatRoom
+ *        Mediator interface : the only way Persons
+ *        can communicate with each other.
+ */
+class IChatRoom
+{
+  public:
+    static constexpr std::size_t kDefaultHistory = 256;
+
+    virtual ~IChatRoom() = default;
+
+    virtual void broadcast(const MessagePtr &p_msg) = 0;
+
+    /*!
+     * @brief Broadcasts a batch of messages with a single walk of the
+     *        membership : each member receives all the messages it did
+     *        not send itself in one call.
+     */
+    virtual void broadcast(const std::vector<MessagePtr> &p_batch) = 0;
+
+    virtual void join ( Person* p ) = 0;
+
+    virtual void leave( Person* p ) = 0;
+
+    virtual void message(const std::string &p_to,
+                         const MessagePtr  &p_msg) = 0;
+
+    /*!
+     * @brief How many messages the Persons joining this room keep in
+     *        their history (a Person can still change its own).
+     */
+    void        setHistoryCapacity(std::size_t p_capacity) { m_historyCapacity = p_capacity; }
+    std::size_t historyCapacity(void) const                 { return m_historyCapacity; }
+
+    /*!
+     * @brief Where the Persons joining this room output what they
+     *        receive (a Person can still change its own).
+     *        The sink must outlive them.
+     */
+    void   setSink(ISink &p_sink) { m_sink = &p_sink; }
+    ISink& sink(void) const       { return *m_sink;   }
+
+  protected:
+    IChatRoom() = default;
+
+    std::size_t m_historyCapacity{kDefaultHistory};
+    ISink*      m_sink{&ISink::standard()};
+};
+
+#endif // ICHATROOM_H
@@ -0,0 +1,254 @@
+#include "Journal.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define JOURNAL_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kInitialCapacity = 1 << 20;
+
+[[noreturn]] void fail(const char* p_what)
+{
+  throw std::system_error(errno, std::generic_category(), p_what);
+}
+
+/*!
+ * @brief CRC-32C, eight bytes at a time (slicing-by-8).
+ */
+uint32_t crc32cSoftware(const char* p_data, std::size_t p_size, uint32_t p_crc)
+{
+  static const auto s_tables = [] {
+    std::array<std::array<uint32_t, 256>, 8> l_tables{};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+      uint32_t l_crc = i;
+      for (int k = 0; k < 8; ++k)
+        l_crc = (l_crc >> 1) ^ (0x82F63B78u & (0u - (l_crc & 1)));
+      l_tables[0][i] = l_crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+      for (std::size_t t = 1; t < 8; ++t)
+        l_tables[t][i] = (l_tables[t - 1][i] >> 8) ^ l_tables[0][l_tables[t - 1][i] & 0xFF];
+    return l_tables;
+  }();
+  const auto& T = s_tables;
+
+  const auto* l_bytes = reinterpret_cast<const uint8_t*>(p_data);
+  for (; p_size >= 8; l_bytes += 8, p_size -= 8)
+  {
+    const uint32_t l_lo = p_crc ^ (uint32_t{l_bytes[0]}       | uint32_t{l_bytes[1]} << 8 |
+                                   uint32_t{l_bytes[2]} << 16 | uint32_t{l_bytes[3]} << 24);
+    const uint32_t l_hi =          uint32_t{l_bytes[4]}       | uint32_t{l_bytes[5]} << 8 |
+                                   uint32_t{l_bytes[6]} << 16 | uint32_t{l_bytes[7]} << 24;
+    p_crc = T[7][l_lo & 0xFF] ^ T[6][(l_lo >> 8) & 0xFF] ^ T[5][(l_lo >> 16) & 0xFF] ^ T[4][l_lo >> 24] ^
+            T[3][l_hi & 0xFF] ^ T[2][(l_hi >> 8) & 0xFF] ^ T[1][(l_hi >> 16) & 0xFF] ^ T[0][l_hi >> 24];
+  }
+  for (; p_size; ++l_bytes, --p_size)
+    p_crc = T[0][(p_crc ^ *l_bytes) & 0xFF] ^ (p_crc >> 8);
+  return p_crc;
+}
+
+#if JOURNAL_CRC32C_SSE42
+/*!
+ * @brief CRC-32C with the SSE 4.2 instruction, when the CPU has it.
+ */
+__attribute__((target("sse4.2")))
+uint32_t crc32cHardware(const char* p_data, std::size_t p_size, uint32_t p_crc)
+{
+  uint64_t l_crc = p_crc;
+  for (; p_size >= 8; p_data += 8, p_size -= 8)
+  {
+    uint64_t l_word;
+    std::memcpy(&l_word, p_data, sizeof(l_word));
+    l_crc = _mm_crc32_u64(l_crc, l_word);
+  }
+  p_crc = static_cast<uint32_t>(l_crc);
+  for (; p_size; ++p_data, --p_size)
+    p_crc = _mm_crc32_u8(p_crc, static_cast<uint8_t>(*p_data));
+  return p_crc;
+}
+#endif
+
+/*!
+ * @brief Checksum of the records : replay must not be bound by it.
+ */
+uint32_t crc32c(const char* p_data, std::size_t p_size)
+{
+#if JOURNAL_CRC32C_SSE42
+  static const auto s_impl = __builtin_cpu_supports("sse4.2") ? crc32cHardware : crc32cSoftware;
+#else
+  static const auto s_impl = crc32cSoftware;
+#endif
+  return ~s_impl(p_data, p_size, ~0u);
+}
+
+} // namespace
+
+Journal::Journal(const std::string &p_path, std::size_t p_commitEvery) :
+m_commitEvery(p_commitEvery)
+{
+  m_fd = ::open(p_path.c_str(), O_RDWR | O_CREAT, 0644);
+  if ( m_fd < 0 ) fail("Journal: open");
+
+  // The destructor does not run if we throw.
+  try
+  {
+    struct stat l_stat;
+    if ( ::fstat(m_fd, &l_stat) != 0 ) fail("Journal: fstat");
+    const auto l_size = static_cast<uint64_t>(l_stat.st_size);
+
+    // Only an empty file is made a journal : anything else must already be one.
+    const bool l_fresh = l_size == 0;
+    if ( !l_fresh )
+    {
+      FileHeader l_header;
+      const ssize_t l_read = ::pread(m_fd, &l_header, sizeof(l_header), 0);
+      if ( l_read < 0 ) fail("Journal: pread");
+      if ( static_cast<std::size_t>(l_read) != sizeof(l_header) ||
+           l_header.magic != kMagic                            ||
+           l_header.end < sizeof(FileHeader) || l_header.end > l_size )
+      {
+        errno = EINVAL;
+        fail("Journal: not a chat journal");
+      }
+    }
+
+    map(std::max<std::size_t>(kInitialCapacity, l_size));
+
+    auto* l_header = reinterpret_cast<FileHeader*>(m_data);
+    if ( l_fresh )
+    {
+      *l_header = {kMagic, sizeof(FileHeader)};
+      flush(0, sizeof(FileHeader));
+    }
+
+    // Cut a torn or corrupt tail, so that new records follow the valid ones.
+    uint64_t l_valid = sizeof(FileHeader);
+    Record   l_record;
+    for ( uint64_t l_next; (l_next = read(l_valid, l_header->end, l_record)) != 0; )
+      l_valid = l_next;
+    if ( l_valid != l_header->end )
+    {
+      l_header->end = l_valid;
+      flush(0, sizeof(FileHeader));
+    }
+    m_synced = l_header->end;
+  }
+  catch (...)
+  {
+    if ( m_data ) ::munmap(m_data, m_capacity);
+    ::close(m_fd);
+    throw;
+  }
+}
+
+Journal::~Journal()
+{
+  // Nobody to report to : the records since the last commit may be lost.
+  try { commit(); }
+  catch (const std::system_error&) {}
+  ::munmap(m_data, m_capacity);
+  ::close(m_fd);
+}
+
+uint64_t Journal::read(uint64_t p_offset, uint64_t p_end, Record &p_record) const
+{
+  RecordHeader l_header;
+  if ( p_offset >= p_end || p_end - p_offset < sizeof(l_header) ) return 0;
+  const char* l_cursor = m_data + p_offset;
+  std::memcpy(&l_header, l_cursor, sizeof(l_header));
+
+  const uint64_t l_size = sizeof(l_header) + uint64_t{l_header.fromSize} + l_header.toSize + l_header.textSize;
+  if ( p_end - p_offset < l_size ||
+       l_header.event > static_cast<uint8_t>(Event::Message) ||
+       crc32c(l_cursor + sizeof(l_header.crc), l_size - sizeof(l_header.crc)) != l_header.crc )
+    return 0;
+
+  l_cursor += sizeof(l_header);
+  p_record = {static_cast<Event>(l_header.event),
+              {l_cursor,                                       l_header.fromSize},
+              {l_cursor + l_header.fromSize,                   l_header.toSize  },
+              {l_cursor + l_header.fromSize + l_header.toSize, l_header.textSize}};
+  return p_offset + l_size;
+}
+
+void Journal::map(std::size_t p_capacity)
+{
+  if ( m_data )
+    ::munmap(m_data, m_capacity);
+  m_data = nullptr;
+
+  if ( ::ftruncate(m_fd, static_cast<off_t>(p_capacity)) != 0 ) fail("Journal: ftruncate");
+  void* l_data = ::mmap(nullptr, p_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if ( l_data == MAP_FAILED ) fail("Journal: mmap");
+
+  m_data     = static_cast<char*>(l_data);
+  m_capacity = p_capacity;
+}
+
+void Journal::flush(std::size_t p_from, std::size_t p_to)
+{
+  static const std::size_t l_page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const std::size_t l_begin = p_from & ~(l_page - 1);
+  if ( ::msync(m_data + l_begin, p_to - l_begin, MS_SYNC) != 0 ) fail("Journal: msync");
+}
+
+void Journal::append(Event            p_event,
+                     std::string_view p_from,
+                     std::string_view p_to,
+                     std::string_view p_text)
+{
+  // Field sizes are bounded by the record format.
+  p_from = p_from.substr(0, UINT16_MAX);
+  p_to   = p_to  .substr(0, UINT16_MAX);
+  p_text = p_text.substr(0, UINT32_MAX);
+
+  RecordHeader l_header{0,
+                        static_cast<uint32_t>(p_text.size()),
+                        static_cast<uint16_t>(p_from.size()),
+                        static_cast<uint16_t>(p_to.size()),
+                        static_cast<uint8_t >(p_event),
+                        {0, 0, 0}};
+  const uint64_t l_begin = end();
+  const uint64_t l_end   = l_begin + sizeof(l_header) + p_from.size() + p_to.size() + p_text.size();
+  if ( l_end > m_capacity )
+    map(std::max<std::size_t>(m_capacity * 2, l_end));
+
+  char* l_cursor = m_data + l_begin;
+  std::memcpy(l_cursor, &l_header, sizeof(l_header)); l_cursor += sizeof(l_header);
+  l_cursor = std::copy(std::begin(p_from), std::end(p_from), l_cursor);
+  l_cursor = std::copy(std::begin(p_to),   std::end(p_to),   l_cursor);
+  std::copy(std::begin(p_text), std::end(p_text), l_cursor);
+
+  l_header.crc = crc32c(m_data + l_begin + sizeof(l_header.crc), l_end - l_begin - sizeof(l_header.crc));
+  std::memcpy(m_data + l_begin, &l_header.crc, sizeof(l_header.crc));
+
+  // Publish the record only once it is complete.
+  reinterpret_cast<FileHeader*>(m_data)->end = l_end;
+
+  if ( m_commitEvery && ++m_pending >= m_commitEvery )
+    commit();
+}
+
+void Journal::commit()
+{
+  const uint64_t l_end = end();
+  if ( l_end == m_synced ) return;
+
+  flush(m_synced, l_end);
+  flush(0, sizeof(FileHeader));
+  m_synced  = l_end;
+  m_pending = 0;
+}
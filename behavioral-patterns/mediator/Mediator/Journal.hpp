@@ -0,0 +1,133 @@
+#ifndef  JOURNAL_H
+#define JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/*!
+ * @brief Journal
+ *        Append-only, memory-mapped binary log of what a ChatRoom routed.
+ *
+ *        File layout :
+ *         - a header : magic number and the offset of the end of the
+ *           last complete record,
+ *         - records : a fixed RecordHeader followed by the 'from', 'to'
+ *           and 'text' bytes, checksummed with CRC-32C.
+ *
+ *        Appending only copies bytes into the mapping. Durability is
+ *        obtained by group commit : the dirty range is flushed to disk
+ *        once every 'p_commitEvery' records, or on commit()/destruction.
+ *        The kernel may still write the header back before the records it
+ *        covers : reading stops at the first record that is incomplete or
+ *        fails its checksum, and opening cuts the journal there.
+ *
+ *        Not thread safe : meant to be driven by a (single-threaded) ChatRoom.
+ */
+class Journal
+{
+  public:
+    enum class Event : uint8_t { Join, Leave, Broadcast, Message };
+
+    /*!
+     * @brief Record
+     *        A replayed record. The views point into the mapping and
+     *        are only valid during the replay callback.
+     */
+    struct Record
+    {
+      Event            event;
+      std::string_view from;
+      std::string_view to;
+      std::string_view text;
+    };
+
+    /*!
+     * @param p_path        Opened for appending after its last valid record if
+     *                      it is a journal, initialised if empty or missing.
+     * @param p_commitEvery Number of records per group commit (0 : only on commit()).
+     * @throws std::system_error if the file cannot be opened or mapped, or
+     *         is neither empty nor a journal (EINVAL) : it is left untouched.
+     */
+    explicit Journal(const std::string &p_path, std::size_t p_commitEvery = 256);
+    ~Journal();
+
+    Journal(const Journal&)            = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    void append(Event            p_event,
+                std::string_view p_from,
+                std::string_view p_to,
+                std::string_view p_text);
+
+    /*!
+     * @brief Flushes every record appended so far to disk.
+     */
+    void commit();
+
+    /*!
+     * @brief Calls p_visitor(const Record&) for each record, oldest first.
+     * @return The number of records replayed.
+     */
+    template <typename Visitor>
+    std::size_t replay(Visitor &&p_visitor) const
+    {
+      std::size_t l_count = 0;
+      Record      l_record;
+      for ( uint64_t l_offset = sizeof(FileHeader), l_next;
+            (l_next = read(l_offset, end(), l_record)) != 0;
+            l_offset = l_next )
+      {
+        p_visitor(static_cast<const Record&>(l_record));
+        ++l_count;
+      }
+      return l_count;
+    }
+
+    /*!
+     * @brief Bytes used by the records.
+     */
+    uint64_t size() const { return end() - sizeof(FileHeader); }
+
+  private:
+    static constexpr uint64_t kMagic = 0x324e524a54414843ull; // "CHATJRN2" : CRC-32C records
+
+    struct FileHeader
+    {
+      uint64_t magic;
+      uint64_t end;   /*!< Offset following the last complete record */
+    };
+
+    struct RecordHeader
+    {
+      uint32_t crc;         /*!< Of the rest of the record, header included */
+      uint32_t textSize;
+      uint16_t fromSize;
+      uint16_t toSize;
+      uint8_t  event;
+      uint8_t  reserved[3];
+    };
+
+    uint64_t end() const { return reinterpret_cast<const FileHeader*>(m_data)->end; }
+
+    /*!
+     * @brief Reads the record at p_offset, if it ends before p_end and
+     *        its checksum matches.
+     * @return The offset following it, 0 otherwise.
+     */
+    uint64_t read(uint64_t p_offset, uint64_t p_end, Record &p_record) const;
+
+    void map(std::size_t p_capacity);
+    void flush(std::size_t p_from, std::size_t p_to);
+
+    int               m_fd{-1};
+    char*             m_data{nullptr};
+    std::size_t       m_capacity{0};
+    const std::size_t m_commitEvery;
+    std::size_t       m_pending{0}; /*!< Records appended since the last commit */
+    uint64_t          m_synced{0};  /*!< End of the data known to be on disk     */
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,301 @@
+/*!
+ * Synthetic load generator for the Mediator example.
+ *
+ * Usage : MediatorLoadGen [--option value]...
+ *
+ *   --members   N                   Persons in the room                (1000)
+ *   --messages  N                   Operations to run, all threads     (100000)
+ *   --size      B                   Message payload, in bytes          (64)
+ *   --pm-ratio  R                   Share of private messages, 0..1    (0.1)
+ *   --churn     R                   Share of leave+join, 0..1          (0.01)
+ *   --threads   N                   Sending threads                    (1)
+ *   --room      single|concurrent   ChatRoom or ConcurrentChatRoom     (single)
+ *   --delivery  sync|async          Person delivery mode               (sync)
+ *   --sink      null|buffered|stream  Output sink, to /dev/null        (null)
+ *   --seed      N                   Random seed                        (42)
+ *   --json      PATH                Also write the report as JSON ('-' : stdout)
+ *
+ * Each thread owns a slice of the members : they send from it and
+ * churn it (the Person leaves and joins again under the same name).
+ */
+
+#include "BenchUtils.hpp"
+#include "BufferedSink.hpp"
+#include "ChatRoom.hpp"
+#include "ConcurrentChatRoom.hpp"
+#include "DeliveryPool.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace bench;
+
+struct Config
+{
+  std::size_t members     = 1000;
+  std::size_t messages    = 100000;
+  std::size_t size        = 64;
+  double      pmRatio     = 0.1;
+  double      churn       = 0.01;
+  std::size_t threads     = 1;
+  std::string room        = "single";
+  std::string delivery    = "sync";
+  std::string sink        = "null";
+  uint64_t    seed        = 42;
+  std::string json;
+};
+
+enum Operation { kSay, kPm, kChurn, kOperations };
+const char* const kOperationNames[kOperations] = {"say", "pm", "churn"};
+
+/*!
+ * @brief What one sending thread measured.
+ */
+struct Samples
+{
+  std::vector<double> latencies[kOperations]; /*!< Microseconds */
+};
+
+Config parse(int argc, char** argv)
+{
+  Config l_config;
+  for (int i = 1; i < argc; i += 2)
+  {
+    const std::string l_key = argv[i];
+    if ( i + 1 >= argc ) throw std::invalid_argument("missing value for " + l_key);
+    const std::string l_value = argv[i + 1];
+
+    if      ( l_key == "--members"  ) l_config.members  = std::stoul(l_value);
+    else if ( l_key == "--messages" ) l_config.messages = std::stoul(l_value);
+    else if ( l_key == "--size"     ) l_config.size     = std::stoul(l_value);
+    else if ( l_key == "--pm-ratio" ) l_config.pmRatio  = std::stod (l_value);
+    else if ( l_key == "--churn"    ) l_config.churn    = std::stod (l_value);
+    else if ( l_key == "--threads"  ) l_config.threads  = std::stoul(l_value);
+    else if ( l_key == "--room"     ) l_config.room     = l_value;
+    else if ( l_key == "--delivery" ) l_config.delivery = l_value;
+    else if ( l_key == "--sink"     ) l_config.sink     = l_value;
+    else if ( l_key == "--seed"     ) l_config.seed     = std::stoull(l_value);
+    else if ( l_key == "--json"     ) l_config.json     = l_value;
+    else throw std::invalid_argument("unknown option " + l_key);
+  }
+
+  if ( l_config.messages == 0 )
+    throw std::invalid_argument("--messages must be at least 1");
+  if ( l_config.members < 2 || l_config.threads == 0 || l_config.threads > l_config.members )
+    throw std::invalid_argument("need at least 2 members and 1 to 'members' threads");
+  if ( l_config.room != "single" && l_config.room != "concurrent" )
+    throw std::invalid_argument("--room must be single or concurrent");
+  if ( l_config.room == "single" && l_config.threads > 1 )
+    throw std::invalid_argument("a single ChatRoom is not thread safe : use --room concurrent");
+  if ( l_config.delivery != "sync" && l_config.delivery != "async" )
+    throw std::invalid_argument("--delivery must be sync or async");
+  if ( l_config.sink != "null" && l_config.sink != "buffered" && l_config.sink != "stream" )
+    throw std::invalid_argument("--sink must be null, buffered or stream");
+  if ( l_config.pmRatio < 0. || l_config.churn < 0. || l_config.pmRatio + l_config.churn > 1. )
+    throw std::invalid_argument("--pm-ratio and --churn must be ratios summing to 1 at most");
+  return l_config;
+}
+
+/*!
+ * @brief Minimal JSON emitter, enough for a flat report.
+ *        Non finite numbers, which JSON cannot represent, are written as null.
+ */
+class Json
+{
+  public:
+    Json() { m_out << std::setprecision(std::numeric_limits<double>::max_digits10); }
+
+    Json& open (const char* p_key = nullptr) { key(p_key); m_out << "{"; m_first = true; return *this; }
+    Json& close(void)                        { m_out << "}"; m_first = false; return *this; }
+
+    Json& field(const char* p_key, const std::string &p_value) { key(p_key); m_out << '"' << p_value << '"'; return *this; }
+    Json& field(const char* p_key, double p_value)
+    {
+      key(p_key);
+      if ( std::isfinite(p_value) ) m_out << p_value;
+      else                          m_out << "null";
+      return *this;
+    }
+    Json& field(const char* p_key, uint64_t p_value)           { key(p_key); m_out << p_value; return *this; }
+
+    std::string str(void) const { return m_out.str(); }
+
+  private:
+    void key(const char* p_key)
+    {
+      if ( !m_first ) m_out << ",";
+      m_first = false;
+      if ( p_key ) m_out << '"' << p_key << "\":";
+    }
+
+    std::ostringstream m_out;
+    bool               m_first{true};
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Config l_config;
+  try { l_config = parse(argc, argv); }
+  catch (const std::exception& e)
+  {
+    std::cerr << "MediatorLoadGen: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // Output
+  std::ofstream          l_devNull{"/dev/null"};
+  const int              l_fd = ::open("/dev/null", O_WRONLY);
+  std::unique_ptr<ISink> l_sink;
+  if      ( l_config.sink == "buffered" ) l_sink = std::make_unique<BufferedSink>(l_fd);
+  else if ( l_config.sink == "stream"   ) l_sink = std::make_unique<StreamSink>(l_devNull);
+  else                                    l_sink = std::make_unique<NullSink>();
+
+  // Room and members
+  std::unique_ptr<IChatRoom> l_room;
+  if ( l_config.room == "concurrent" ) l_room = std::make_unique<ConcurrentChatRoom>(0, false);
+  else                                 l_room = std::make_unique<ChatRoom>(false);
+  l_room->setSink(*l_sink);
+
+  std::unique_ptr<DeliveryPool> l_pool;
+  if ( l_config.delivery == "async" )
+    l_pool = std::make_unique<DeliveryPool>();
+
+  auto l_join = [&](std::size_t p_index) {
+    const std::string l_name = "user" + std::to_string(p_index);
+    return l_pool ? std::make_unique<Person>(l_name, *l_room, *l_pool)
+                  : std::make_unique<Person>(l_name, *l_room);
+  };
+  std::vector<std::unique_ptr<Person>> l_people;
+  for (std::size_t i = 0; i < l_config.members; ++i)
+    l_people.push_back(l_join(i));
+
+  // Load
+  const std::string    l_payload(l_config.size, 'x');
+  std::vector<Samples> l_samples(l_config.threads);
+  std::vector<std::thread> l_workers;
+
+  const uint64_t l_allocations = allocations();
+  const auto     l_start       = Clock::now();
+  for (std::size_t t = 0; t < l_config.threads; ++t)
+    l_workers.emplace_back([&, t] {
+      std::mt19937_64                            l_rng{l_config.seed + t};
+      std::uniform_real_distribution<double>     l_draw{0., 1.};
+      std::uniform_int_distribution<std::size_t> l_anyone{0, l_config.members - 1};
+      std::uniform_int_distribution<std::size_t> l_mine{0, (l_config.members - 1 - t) / l_config.threads};
+
+      Samples& l_out = l_samples[t];
+      for (std::size_t i = t; i < l_config.messages; i += l_config.threads)
+      {
+        const std::size_t l_me = t + l_mine(l_rng) * l_config.threads;
+        const double      l_op = l_draw(l_rng);
+        auto              l_opStart = Clock::now();
+        Operation         l_kind;
+
+        if ( l_op < l_config.churn )
+        {
+          l_people[l_me].reset();
+          l_people[l_me] = l_join(l_me);
+          l_kind = kChurn;
+        }
+        else if ( l_op < l_config.churn + l_config.pmRatio )
+        {
+          l_people[l_me]->pm("user" + std::to_string(l_anyone(l_rng)), l_payload);
+          l_kind = kPm;
+        }
+        else
+        {
+          l_people[l_me]->say(l_payload);
+          l_kind = kSay;
+        }
+        l_out.latencies[l_kind].push_back(elapsedNs(l_opStart, 1) / 1e3);
+      }
+    });
+  for (auto& l_worker : l_workers)
+    l_worker.join();
+  if ( l_pool )
+    l_pool->quiesce();
+  l_sink->flush();
+  const double l_seconds = elapsedNs(l_start, 1) / 1e9;
+  const double l_allocs  = static_cast<double>(allocations() - l_allocations);
+
+  // Report
+  Samples l_all;
+  for (auto& l_thread : l_samples)
+    for (int k = 0; k < kOperations; ++k)
+      l_all.latencies[k].insert(std::end(l_all.latencies[k]),
+                                std::begin(l_thread.latencies[k]), std::end(l_thread.latencies[k]));
+  const double l_deliveries = static_cast<double>(l_all.latencies[kSay].size()) * (l_config.members - 1)
+                            + static_cast<double>(l_all.latencies[kPm].size());
+
+  Json l_json;
+  l_json.open()
+        .open("config")
+          .field("members",  uint64_t{l_config.members})
+          .field("messages", uint64_t{l_config.messages})
+          .field("size",     uint64_t{l_config.size})
+          .field("pm_ratio", l_config.pmRatio)
+          .field("churn",    l_config.churn)
+          .field("threads",  uint64_t{l_config.threads})
+          .field("room",     l_config.room)
+          .field("delivery", l_config.delivery)
+          .field("sink",     l_config.sink)
+          .field("seed",     l_config.seed)
+        .close()
+        .open("results")
+          .field("duration_s",         l_seconds)
+          .field("ops_per_s",          l_config.messages / l_seconds)
+          .field("deliveries_per_s",   l_deliveries / l_seconds)
+          .field("allocations_per_op", l_allocs / l_config.messages)
+          .field("rss_bytes",          uint64_t{residentBytes()})
+          .field("peak_rss_bytes",     uint64_t{peakResidentBytes()})
+          .open("latency_us");
+
+  std::FILE* l_report = l_config.json == "-" ? stderr : stdout;
+  std::fprintf(l_report, "%zu ops in %.3f s : %.0f ops/s, %.0f deliveries/s, %.1f allocations/op, rss %.1f MiB (peak %.1f MiB)\n",
+              l_config.messages, l_seconds, l_config.messages / l_seconds, l_deliveries / l_seconds,
+              l_allocs / l_config.messages, residentBytes() / double(1 << 20), peakResidentBytes() / double(1 << 20));
+  for (int k = 0; k < kOperations; ++k)
+  {
+    auto& l_lat = l_all.latencies[k];
+    const double l_count = static_cast<double>(l_lat.size());
+    const double l_p50 = percentile(l_lat, .5), l_p90 = percentile(l_lat, .9),
+                 l_p99 = percentile(l_lat, .99), l_p999 = percentile(l_lat, .999),
+                 l_max = percentile(l_lat, 1.);
+    std::fprintf(l_report, "  %-5s count=%-8.0f p50=%9.2f us  p90=%9.2f us  p99=%9.2f us  p99.9=%9.2f us  max=%9.2f us\n",
+                kOperationNames[k], l_count, l_p50, l_p90, l_p99, l_p999, l_max);
+    l_json.open(kOperationNames[k])
+            .field("count", uint64_t{l_lat.size()}).field("p50", l_p50).field("p90", l_p90)
+            .field("p99", l_p99).field("p999", l_p999).field("max", l_max)
+          .close();
+  }
+  l_json.close().close().close();
+
+  if ( l_config.json == "-" )
+    std::cout << l_json.str() << "\n";
+  else if ( !l_config.json.empty() )
+    std::ofstream(l_config.json) << l_json.str() << "\n";
+
+  release(l_people);
+  l_pool.reset();
+  ::close(l_fd);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#ifndef  MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/*!
+ * @brief What a sender does when the recipient's mailbox is full.
+ */
+enum class Backpressure
+{
+  DropOldest, /*!< Evict the oldest pending message         */
+  Block,      /*!< Wait until the recipient catches up       */
+  Reject      /*!< Drop the new message, receive() is false  */
+};
+
+/*!
+ * @brief Mailbox
+ *        Bounded lock-free queue (D. Vyukov's sequenced ring buffer).
+ *
+ *        Any number of senders push concurrently. It is drained by a single
+ *        delivery worker at a time, but tryPop() stays safe to call from a
+ *        sender too, which is what the drop-oldest policy relies on.
+ */
+template <typename T>
+class Mailbox
+{
+  public:
+    /*!
+     * @param p_capacity Rounded up to the next power of two.
+     */
+    explicit Mailbox(std::size_t p_capacity) :
+    m_capacity(roundUp(p_capacity)), m_mask(m_capacity - 1),
+    m_cells(new Cell[m_capacity])
+    {
+      for (std::size_t i = 0; i < m_capacity; ++i)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    Mailbox(const Mailbox&)            = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    bool tryPush(T&& p_value)
+    {
+      std::size_t l_pos = m_tail.load(std::memory_order_relaxed);
+      for (;;)
+      {
+        Cell&       l_cell = m_cells[l_pos & m_mask];
+        std::size_t l_seq  = l_cell.sequence.load(std::memory_order_acquire);
+        auto        l_diff = static_cast<std::ptrdiff_t>(l_seq) - static_cast<std::ptrdiff_t>(l_pos);
+        if ( l_diff == 0 )
+        {
+          if ( m_tail.compare_exchange_weak(l_pos, l_pos + 1, std::memory_order_relaxed) )
+          {
+            l_cell.value = std::move(p_value);
+            l_cell.sequence.store(l_pos + 1, std::memory_order_release);
+            return true;
+          }
+        }
+        else if ( l_diff < 0 ) { return false; } // Full
+        else                   { l_pos = m_tail.load(std::memory_order_relaxed); }
+      }
+    }
+
+    bool tryPop(T& p_value)
+    {
+      std::size_t l_pos = m_head.load(std::memory_order_relaxed);
+      for (;;)
+      {
+        Cell&       l_cell = m_cells[l_pos & m_mask];
+        std::size_t l_seq  = l_cell.sequence.load(std::memory_order_acquire);
+        auto        l_diff = static_cast<std::ptrdiff_t>(l_seq) - static_cast<std::ptrdiff_t>(l_pos + 1);
+        if ( l_diff == 0 )
+        {
+          if ( m_head.compare_exchange_weak(l_pos, l_pos + 1, std::memory_order_relaxed) )
+          {
+            p_value = std::move(l_cell.value);
+            l_cell.sequence.store(l_pos + m_capacity, std::memory_order_release);
+            return true;
+          }
+        }
+        else if ( l_diff < 0 ) { return false; } // Empty
+        else                   { l_pos = m_head.load(std::memory_order_relaxed); }
+      }
+    }
+
+    bool empty() const
+    {
+      return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const { return m_capacity; }
+
+  private:
+    struct Cell
+    {
+      std::atomic<std::size_t> sequence;
+      T                        value;
+    };
+
+    static std::size_t roundUp(std::size_t p_value)
+    {
+      std::size_t l_pow = 1;
+      while ( l_pow < p_value ) l_pow <<= 1;
+      return l_pow;
+    }
+
+    const std::size_t       m_capacity;
+    const std::size_t       m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    alignas(64) std::atomic<std::size_t> m_head{0};
+};
+
+#endif // MAILBOX_H
@@ -0,0 +1,82 @@
+#ifndef  MESSAGE_H
+#define MESSAGE_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Message;
+
+/*!
+ * @brief Messages are shared : one is created per say()/pm() and every
+ *        recipient, mailbox and log entry only holds a reference to it.
+ */
+using MessagePtr = std::shared_ptr<const Message>;
+
+/*!
+ * @brief Message
+ *        Immutable chat line. Its text representation is only
+ *        built when someone actually reads it.
+ */
+class Message
+{
+  public:
+    static MessagePtr create(std::string p_from, std::string p_text)
+    {
+      return std::make_shared<const Message>(std::move(p_from), std::move(p_text));
+    }
+
+    /*!
+     * @brief Merges runs of consecutive messages from the same sender
+     *        into a single message, one line per original message.
+     */
+    static std::vector<MessagePtr> coalesce(const std::vector<MessagePtr> &p_batch)
+    {
+      std::vector<MessagePtr> l_coalesced;
+      for (std::size_t i = 0; i < p_batch.size(); )
+      {
+        std::size_t j = i + 1;
+        while ( j < p_batch.size() && p_batch[j]->from() == p_batch[i]->from() ) ++j;
+
+        if ( j == i + 1 )
+          l_coalesced.push_back(p_batch[i]);
+        else
+        {
+          std::string l_text{p_batch[i]->text()};
+          for (std::size_t k = i + 1; k < j; ++k)
+            l_text.append("\n").append(p_batch[k]->text());
+          l_coalesced.push_back(create(p_batch[i]->from(), std::move(l_text)));
+        }
+        i = j;
+      }
+      return l_coalesced;
+    }
+
+    Message(std::string p_from, std::string p_text) :
+    m_from(std::move(p_from)), m_text(std::move(p_text)) {}
+
+    const std::string& from(void) const { return m_from; }
+    const std::string& text(void) const { return m_text; }
+
+    /*!
+     * @brief Formats the message as 'from: "text"'.
+     */
+    std::string str(void) const
+    {
+      std::string l_str;
+      l_str.reserve(m_from.size() + m_text.size() + 4);
+      return l_str.append(m_from).append(": \"").append(m_text).append("\"");
+    }
+
+    friend std::ostream& operator<<(std::ostream &p_os, const Message &p_msg)
+    {
+      return p_os << p_msg.m_from << ": \"" << p_msg.m_text << "\"";
+    }
+
+  private:
+    const std::string m_from;
+    const std::string m_text;
+};
+
+#endif // MESSAGE_H
@@ -1,10 +1,19 @@
 #include "Person.hpp"
 #include "ChatRoom.hpp"
-#include <iostream>
+#include "DeliveryPool.hpp"
 #include <string>
+#include <thread>
 
-Person::Person(const std::string &p_name, ChatRoom &p_room) : 
-m_name(p_name), m_room(p_room)
+Person::Person(const std::string &p_name, IChatRoom &p_room) : 
+m_name(p_name), m_room(p_room), m_logs(p_room.historyCapacity()), m_sink(&p_room.sink())
+{
+  m_room.join( this );
+}
+
+Person::Person(const std::string &p_name, IChatRoom &p_room, DeliveryPool &p_pool,
+               std::size_t p_capacity, Backpressure p_policy) :
+m_name(p_name), m_room(p_room), m_logs(p_room.historyCapacity()), m_sink(&p_room.sink()),
+m_pool(&p_pool), m_mailbox(std::make_unique<Mailbox<MessagePtr>>(p_capacity)), m_policy(p_policy)
 {
   m_room.join( this );
 }
@@ -12,23 +21,125 @@ m_name(p_name), m_room(p_room)
 Person::~Person() 
 {
   m_room.leave(this);
+
+  // Nobody can post anymore : wait for the pool to be done with us.
+  while ( m_runs.load() != 0 )
+    std::this_thread::yield();
 }
 
 void Person::say(const std::string &p_msg) const
 {
-  m_room.broadcast(m_name, p_msg);
+  m_room.broadcast(Message::create(m_name, p_msg));
+}
+
+void Person::say(const std::vector<std::string>& p_lines, bool p_coalesce) const
+{
+  std::vector<MessagePtr> l_batch;
+  l_batch.reserve(p_lines.size());
+  for (const auto& l_line : p_lines)
+    l_batch.push_back(Message::create(m_name, l_line));
+  m_room.broadcast(p_coalesce ? Message::coalesce(l_batch) : l_batch);
 }
 
 void Person::pm(const std::string &p_to, const std::string &p_msg) const
 {
-  m_room.message(m_name, p_to, p_msg);
+  m_room.message(p_to, Message::create(m_name, p_msg));
+}
+
+void Person::setHistoryCapacity(std::size_t p_capacity)
+{
+  std::lock_guard<std::mutex> l_lock(m_mutex);
+  m_logs.setCapacity(p_capacity);
+}
+
+bool Person::receive(const MessagePtr &p_msg)
+{
+  return receive(&p_msg, 1) == 1;
+}
+
+std::size_t Person::receive(const MessagePtr* p_msgs, std::size_t p_count)
+{
+  if ( !m_mailbox )
+  {
+    handle(p_msgs, p_count);
+    return p_count;
+  }
+
+  std::size_t l_accepted = 0;
+  for (std::size_t i = 0; i < p_count; ++i)
+    l_accepted += post(p_msgs[i]);
+
+  if ( l_accepted )
+    wakeUp();
+  return l_accepted;
+}
+
+bool Person::post(const MessagePtr &p_msg)
+{
+  MessagePtr l_msg{p_msg};
+  while ( !m_mailbox->tryPush(std::move(l_msg)) )
+  {
+    switch ( m_policy )
+    {
+    case Backpressure::Reject:
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    case Backpressure::DropOldest:
+      {
+        MessagePtr l_oldest;
+        if ( m_mailbox->tryPop(l_oldest) )
+          m_dropped.fetch_add(1, std::memory_order_relaxed);
+      }
+      break;
+    case Backpressure::Block:
+      wakeUp(); // What is already posted must be drained for us to go on
+      std::this_thread::yield();
+      break;
+    }
+  }
+  return true;
+}
+
+void Person::wakeUp(void)
+{
+  if ( !m_scheduled.exchange(true) )
+  {
+    m_runs.fetch_add(1);
+    m_pool->schedule(this);
+  }
+}
+
+void Person::drain(std::size_t p_batch)
+{
+  thread_local std::vector<MessagePtr> l_batch;
+  MessagePtr                           l_msg;
+  while ( l_batch.size() < p_batch && m_mailbox->tryPop(l_msg) )
+    l_batch.push_back(std::move(l_msg));
+  handle(l_batch.data(), l_batch.size());
+  l_batch.clear();
+
+  // Either keep our turn, or give it back and make sure
+  // a message posted in between is not left behind.
+  if ( m_mailbox->empty() )
+  {
+    m_scheduled.store(false);
+    if ( m_mailbox->empty() || m_scheduled.exchange(true) )
+    {
+      m_runs.fetch_sub(1); // Last access : 'this' may be destroyed from now on
+      return;
+    }
+  }
+  m_pool->schedule(this);
 }
 
-void Person::receive(const std::string &p_from, const std::string &p_msg)
+void Person::handle(const MessagePtr* p_msgs, std::size_t p_count)
 {
-  std::string s{p_from + ": \"" + p_msg + "\""};
-  std::cout << "[" << p_from << "'s chat session]" << s << "\n";
-  m_logs.emplace_back(s);
+  std::lock_guard<std::mutex> l_lock(m_mutex);
+  for (std::size_t i = 0; i < p_count; ++i)
+  {
+    m_sink->write(*this, *p_msgs[i]);
+    m_logs.push(p_msgs[i]);
+  }
 }
 
 bool Person::operator==(const Person &rhs) const {
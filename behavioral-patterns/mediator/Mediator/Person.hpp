@@ -1,31 +1,103 @@
 #ifndef  PERSON_H
 #define PERSON_H
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
-class ChatRoom;
+#include "ChatRoom.hpp"
+#include "History.hpp"
+#include "Mailbox.hpp"
+#include "Message.hpp"
+
+class DeliveryPool;
 
 class Person {
 
 public:
-  Person( const std::string &p_name, ChatRoom& p_room );
+  Person( const std::string &p_name, IChatRoom& p_room );
+
+  /*!
+   * @brief Person with asynchronous delivery : receive() only posts the
+   *        message to a bounded mailbox that p_pool drains, so that senders
+   *        do not wait for this Person to handle it.
+   *        The mailbox is set up before the Person joins p_room.
+   */
+  Person( const std::string &p_name, IChatRoom& p_room, DeliveryPool& p_pool,
+          std::size_t p_capacity = 1024, Backpressure p_policy = Backpressure::Block );
   Person() = delete;
   virtual ~Person();
 
   void say      (const std::string& p_msg) const;
   void pm      (const std::string& p_to    , const std::string& p_msg) const;
-  void receive(const std::string &p_from, const std::string &p_msg);
+  bool receive(const MessagePtr &p_msg);
+
+  /*!
+   * @brief Says several lines at once : the room walks its membership once.
+   * @param p_coalesce Send them as a single multi-line message.
+   */
+  void say(const std::vector<std::string>& p_lines, bool p_coalesce = false) const;
+
+  /*!
+   * @brief Receives a batch of messages in one go.
+   * @return The number of messages accepted (see Backpressure::Reject).
+   */
+  std::size_t receive(const MessagePtr* p_msgs, std::size_t p_count);
+
+  /*!
+   * @brief Number of messages lost because the mailbox was full.
+   */
+  uint64_t dropped(void) const { return m_dropped.load(std::memory_order_relaxed); }
 
   bool operator==(const Person &p_rhs) const;
   bool operator!= (const Person &p_rhs) const;
 
-  std::string getName(void) const { return m_name; }
+  const std::string&      getName(void) const { return m_name; }
+  ChatRoom::ParticipantId getId  (void) const { return m_id;   }
+
+  /*!
+   * @brief The last messages this Person received, oldest first.
+   *        Use Message::str() to get the text of an entry.
+   */
+  const History& getLogs(void) const { return m_logs; }
+
+  /*!
+   * @brief Overrides the history capacity inherited from the room.
+   */
+  void setHistoryCapacity(std::size_t p_capacity);
+
+  /*!
+   * @brief Overrides the output sink inherited from the room.
+   *        Must be called before anyone delivers to this Person.
+   */
+  void setSink(ISink &p_sink) { m_sink = &p_sink; }
 
 private:
+  friend class ChatRoom;
+  friend class DeliveryPool;
+
+  bool post  (const MessagePtr &p_msg);
+  void wakeUp(void);
+  void handle(const MessagePtr* p_msgs, std::size_t p_count);
+  void drain (std::size_t p_batch);
+
   const std::string             m_name;
-  ChatRoom&                  m_room;
-  std::vector<std::string> m_logs{};
+  ChatRoom::ParticipantId  m_id{ChatRoom::kNoParticipant};
+  std::size_t                m_slot{0};   /*!< Index in the ChatRoom membership */
+  IChatRoom&                 m_room;
+  std::mutex                 m_mutex;  /*!< Rooms may deliver from several threads */
+  History                    m_logs;
+  ISink*                     m_sink;
+
+  DeliveryPool*                        m_pool{nullptr};
+  std::unique_ptr<Mailbox<MessagePtr>> m_mailbox;
+  Backpressure                         m_policy{Backpressure::Block};
+  std::atomic<bool>                    m_scheduled{false};
+  std::atomic<uint32_t>                m_runs{0};     /*!< Queued or running drains */
+  std::atomic<uint64_t>                m_dropped{0};
 
 };
 
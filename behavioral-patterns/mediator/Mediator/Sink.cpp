@@ -0,0 +1,8 @@
+#include "Sink.hpp"
+#include <iostream>
+
+ISink& ISink::standard(void)
+{
+  static StreamSink l_cout{std::cout};
+  return l_cout;
+}
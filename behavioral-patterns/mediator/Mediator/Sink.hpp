@@ -0,0 +1,80 @@
+#ifndef  SINK_H
+#define SINK_H
+
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "Message.hpp"
+
+class Person;
+
+/*!
+ * @brief ISink
+ *        Where Persons output the messages delivered to them.
+ *        Implementations must be thread safe : rooms may deliver from
+ *        several threads.
+ */
+class ISink
+{
+  public:
+    virtual ~ISink() = default;
+
+    virtual void write(const Person &p_to, const Message &p_msg) = 0;
+    virtual void flush(void) {}
+
+    /*!
+     * @brief The sink rooms use unless told otherwise : std::cout.
+     */
+    static ISink& standard(void);
+
+  protected:
+    ISink() = default;
+
+    /*!
+     * @brief Appends the line printed for p_msg to p_out.
+     */
+    static void format(std::string &p_out, const Message &p_msg)
+    {
+      p_out.append("[").append(p_msg.from()).append("'s chat session]")
+           .append(p_msg.from()).append(": \"").append(p_msg.text()).append("\"\n");
+    }
+};
+
+/*!
+ * @brief StreamSink
+ *        Writes each message to an std::ostream, one at a time.
+ */
+class StreamSink : public ISink
+{
+  public:
+    explicit StreamSink(std::ostream &p_os) : m_os(p_os) {}
+
+    void write(const Person&, const Message &p_msg) override
+    {
+      std::lock_guard<std::mutex> l_lock(m_mutex);
+      m_os << "[" << p_msg.from() << "'s chat session]" << p_msg << "\n";
+    }
+
+    void flush(void) override
+    {
+      std::lock_guard<std::mutex> l_lock(m_mutex);
+      m_os.flush();
+    }
+
+  private:
+    std::mutex    m_mutex;
+    std::ostream& m_os;
+};
+
+/*!
+ * @brief NullSink
+ *        Discards everything, e.g. for benchmarking.
+ */
+class NullSink : public ISink
+{
+  public:
+    void write(const Person&, const Message&) override {}
+};
+
+#endif // SINK_H
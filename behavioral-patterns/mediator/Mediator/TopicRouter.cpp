@@ -0,0 +1,109 @@
+#include "TopicRouter.hpp"
+#include "Person.hpp"
+
+TopicRouter::TopicId TopicRouter::topic(const std::string &p_name)
+{
+  auto l_res = m_topicIds.emplace(p_name, static_cast<TopicId>(m_topics.size()));
+  if ( l_res.second )
+    m_topics.emplace_back();
+  return l_res.first->second;
+}
+
+void TopicRouter::subscribe(Person* p, TopicId p_topic)
+{
+  check(p_topic);
+
+  auto l_res = m_subscriberIds.emplace(p, 0);
+  if ( l_res.second )
+  {
+    if ( m_free.empty() )
+    {
+      l_res.first->second = static_cast<uint32_t>(m_people.size());
+      m_people.push_back(p);
+      m_stamps.push_back(0);
+      m_subscriptions.emplace_back();
+    }
+    else
+    {
+      l_res.first->second = m_free.back();
+      m_free.pop_back();
+      m_people[l_res.first->second] = p;
+    }
+  }
+
+  const uint32_t l_id     = l_res.first->second;
+  auto&          l_topics = m_subscriptions[l_id];
+  auto&          l_ids    = m_topics[p_topic];
+  if ( !m_memberships.emplace(key(l_id, p_topic), Slots{static_cast<uint32_t>(l_topics.size()),
+                                                        static_cast<uint32_t>(l_ids.size())}).second )
+    return; // Already subscribed
+
+  l_topics.push_back(p_topic);
+  l_ids.push_back(l_id);
+}
+
+void TopicRouter::unsubscribe(Person* p, TopicId p_topic)
+{
+  auto l_it = m_subscriberIds.find(p);
+  if ( l_it == std::end(m_subscriberIds) ) return;
+
+  const uint32_t l_id         = l_it->second;
+  auto           l_membership = m_memberships.find(key(l_id, p_topic));
+  if ( l_membership == std::end(m_memberships) ) return;
+  const Slots l_slots = l_membership->second;
+  m_memberships.erase(l_membership);
+
+  // Swap-remove from both arrays, and tell the moved entries where they went.
+  auto& l_topics = m_subscriptions[l_id];
+  if ( l_slots.inSubscriber + 1 != l_topics.size() )
+  {
+    l_topics[l_slots.inSubscriber] = l_topics.back();
+    m_memberships[key(l_id, l_topics.back())].inSubscriber = l_slots.inSubscriber;
+  }
+  l_topics.pop_back();
+
+  auto& l_ids = m_topics[p_topic];
+  if ( l_slots.inTopic + 1 != l_ids.size() )
+  {
+    l_ids[l_slots.inTopic] = l_ids.back();
+    m_memberships[key(l_ids.back(), p_topic)].inTopic = l_slots.inTopic;
+  }
+  l_ids.pop_back();
+
+  if ( l_topics.empty() )
+  {
+    m_people[l_id] = nullptr;
+    m_free.push_back(l_id);
+    m_subscriberIds.erase(l_it);
+  }
+}
+
+void TopicRouter::unsubscribe(Person* p)
+{
+  auto l_it = m_subscriberIds.find(p);
+  if ( l_it == std::end(m_subscriberIds) ) return;
+
+  const std::vector<TopicId> l_topics = m_subscriptions[l_it->second];
+  for (TopicId l_topic : l_topics)
+    unsubscribe(p, l_topic);
+}
+
+std::size_t TopicRouter::publish(const std::vector<TopicId> &p_topics,
+                                 const MessagePtr           &p_msg,
+                                 const Person*               p_except)
+{
+  std::size_t l_count = 0;
+  resolve(p_topics.data(), p_topics.size(), p_except,
+          [&](Person* p) { p->receive(p_msg); ++l_count; });
+  return l_count;
+}
+
+std::size_t TopicRouter::publish(TopicId           p_topic,
+                                 const MessagePtr &p_msg,
+                                 const Person*     p_except)
+{
+  std::size_t l_count = 0;
+  resolve(&p_topic, 1, p_except,
+          [&](Person* p) { p->receive(p_msg); ++l_count; });
+  return l_count;
+}
@@ -0,0 +1,134 @@
+#ifndef  TOPICROUTER_H
+#define TOPICROUTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Message.hpp"
+
+class Person;
+
+/*!
+ * @brief TopicRouter
+ *        Mediator between publishers and the Persons subscribed to topics,
+ *        whichever room they are in.
+ *
+ *        Topic names are interned into dense identifiers. Each topic keeps a
+ *        contiguous array of subscriber identifiers, so publishing walks the
+ *        interested subscribers only. When a message is published to
+ *        several topics at once, a subscriber of several of them receives it
+ *        once.
+ *
+ *        Not thread safe. Persons must be unsubscribed before being destroyed.
+ */
+class TopicRouter
+{
+  public:
+    using TopicId = uint32_t;
+
+    /*!
+     * @brief Identifier of p_name, created on first use.
+     */
+    TopicId topic(const std::string &p_name);
+
+    /*!
+     * @throws std::out_of_range if p_topic was not created by topic().
+     */
+    void subscribe  (Person* p, TopicId p_topic);
+    void unsubscribe(Person* p, TopicId p_topic);
+
+    /*!
+     * @brief Removes p from every topic it subscribed to.
+     */
+    void unsubscribe(Person* p);
+
+    /*!
+     * @brief Delivers p_msg to the subscribers of p_topics, once each,
+     *        except p_except (usually the publisher).
+     * @return The number of deliveries.
+     * @throws std::out_of_range if a topic was not created by topic().
+     */
+    std::size_t publish(const std::vector<TopicId> &p_topics,
+                        const MessagePtr           &p_msg,
+                        const Person*               p_except = nullptr);
+
+    std::size_t publish(TopicId           p_topic,
+                        const MessagePtr &p_msg,
+                        const Person*     p_except = nullptr);
+
+    /*!
+     * @brief Calls p_visitor(Person*) once for each subscriber of
+     *        p_topics but p_except, without delivering anything.
+     */
+    template <typename Visitor>
+    void resolve(const TopicId* p_topics, std::size_t p_count,
+                 const Person* p_except, Visitor &&p_visitor);
+
+    std::size_t subscribers(TopicId p_topic) const { return m_topics[p_topic].size(); }
+
+  private:
+    /*!
+     * @brief Where a subscription sits in m_subscriptions and m_topics,
+     *        for O(1) checks and removals.
+     */
+    struct Slots
+    {
+      uint32_t inSubscriber;
+      uint32_t inTopic;
+    };
+
+    static uint64_t key(uint32_t p_id, TopicId p_topic) { return uint64_t{p_id} << 32 | p_topic; }
+
+    void check(TopicId p_topic) const
+    {
+      if ( p_topic >= m_topics.size() ) throw std::out_of_range("TopicRouter: unknown topic");
+    }
+
+    std::unordered_map<std::string, TopicId>    m_topicIds;
+    std::vector<std::vector<uint32_t>>          m_topics;        /*!< topic -> subscriber ids     */
+
+    // Subscribers, by identifier. The hot fields are kept in their own arrays.
+    std::unordered_map<const Person*, uint32_t> m_subscriberIds;
+    std::vector<Person*>                        m_people;
+    std::vector<uint32_t>                       m_stamps;        /*!< Last publication selected for */
+    std::vector<std::vector<TopicId>>           m_subscriptions; /*!< subscriber -> topics        */
+    std::vector<uint32_t>                       m_free;          /*!< Recyclable subscriber ids   */
+    std::unordered_map<uint64_t, Slots>         m_memberships;   /*!< key(subscriber, topic)      */
+    uint32_t                                    m_stamp{0};
+};
+
+template <typename Visitor>
+void TopicRouter::resolve(const TopicId* p_topics, std::size_t p_count,
+                          const Person* p_except, Visitor &&p_visitor)
+{
+  for (std::size_t t = 0; t < p_count; ++t)
+    check(p_topics[t]);
+
+  if ( p_count == 1 )
+  {
+    // A topic holds each subscriber once : no need to deduplicate.
+    for (uint32_t l_id : m_topics[*p_topics])
+      if ( m_people[l_id] != p_except )
+        p_visitor(m_people[l_id]);
+    return;
+  }
+
+  if ( ++m_stamp == 0 )
+  {
+    std::fill(std::begin(m_stamps), std::end(m_stamps), 0);
+    m_stamp = 1;
+  }
+  for (std::size_t t = 0; t < p_count; ++t)
+    for (uint32_t l_id : m_topics[p_topics[t]])
+      if ( m_stamps[l_id] != m_stamp && m_people[l_id] != p_except )
+      {
+        m_stamps[l_id] = m_stamp;
+        p_visitor(m_people[l_id]);
+      }
+}
+
+#endif // TOPICROUTER_H
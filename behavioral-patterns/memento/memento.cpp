@@ -1,14 +1,32 @@
 /*!
  * Example largely inspired by
  * http://www.vishalchovatiya.com/memento-design-pattern-in-modern-cpp/
+ *
+ * Run with --bench to measure the caretakers instead of running the example.
+ * The heap figures of the benchmarks need the global operator new below,
+ * which relies on glibc : build with -DMEMENTO_BENCH to enable it, they
+ * read 0 otherwise.
  */
 
 #include <iostream>
 #include <ostream>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <random>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include <memory>
 
+#ifdef MEMENTO_BENCH
+#include <malloc.h>
+#endif
+
 /*!
  * @brief Originator object
  *        The object we want to produce snapshots from.
@@ -20,6 +38,7 @@
  * 
  *        Also note that in this example, there is absolutely no lifecycle 
  *        management for Mementos and their history can grow indefinetly.
+ *        See History and Retention, below, for a managed CareTaker.
  */
 class BankAccount
 {
@@ -103,8 +122,1163 @@ private:
     std::vector<std::shared_ptr<const Memento> > m_changes;
 };
 
-int main()
+/*!
+ * @brief Retention
+ *        Which snapshots a History keeps.
+ *
+ *        Snapshots are kept in tiers of at most perTier snapshots : when
+ *        one overflows, its oldest snapshot moves to the next tier - one
+ *        out of two only, the other is dropped - so that each tier is half
+ *        as dense as the previous one. Snapshots leaving the last tier, or
+ *        older than window, are dropped. A History therefore never holds
+ *        more than perTier * tiers snapshots.
+ */
+struct Retention
+{
+    using Window = std::chrono::steady_clock::duration;
+
+    std::size_t perTier = SIZE_MAX;
+    std::size_t tiers   = 1;
+    Window      window  = Window::max();
+
+    static Retention all() { return {}; }
+
+    static Retention lastN(std::size_t p_count) { return {p_count, 1, Window::max()}; }
+
+    static Retention timeWindow(Window p_window, std::size_t p_max = SIZE_MAX) { return {p_max, 1, p_window}; }
+
+    /*!
+     * @brief Dense recent snapshots, sparse old ones.
+     */
+    static Retention exponential(std::size_t p_perTier, std::size_t p_tiers) { return {p_perTier, p_tiers, Window::max()}; }
+};
+
+/*!
+ * @brief Ring
+ *        Growable circular buffer : O(1) push_back/pop_front/indexing
+ *        over a single allocation, whose size is a power of two.
+ */
+template <typename T>
+class Ring
+{
+public:
+    void push_back(T p_value)
+    {
+        if ( m_size == m_buffer.size() ) grow();
+        m_buffer[(m_head + m_size++) & (m_buffer.size() - 1)] = std::move(p_value);
+    }
+
+    void pop_front()
+    {
+        m_head = (m_head + 1) & (m_buffer.size() - 1);
+        --m_size;
+    }
+
+    T&       operator[](std::size_t i)       { return m_buffer[(m_head + i) & (m_buffer.size() - 1)]; }
+    const T& operator[](std::size_t i) const { return m_buffer[(m_head + i) & (m_buffer.size() - 1)]; }
+    T&       front()       { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    const T& back () const { return (*this)[m_size - 1]; }
+
+    std::size_t size () const { return m_size; }
+    bool        empty() const { return m_size == 0; }
+
+private:
+    void grow()
+    {
+        std::vector<T> l_buffer(std::max<std::size_t>(4, 2 * m_buffer.size()));
+        for ( std::size_t i = 0; i < m_size; ++i ) l_buffer[i] = std::move((*this)[i]);
+        m_buffer.swap(l_buffer);
+        m_head = 0;
+    }
+
+    std::vector<T> m_buffer;
+    std::size_t    m_head{0};
+    std::size_t    m_size{0};
+};
+
+/*!
+ * @brief History
+ *        CareTaker keeping the states of an Originator by value, in
+ *        contiguous storage, instead of one shared Memento each.
+ *
+ *        Snapshots are referenced by integer Handles : a Handle is the
+ *        rank of the snapshot since the first one, it stays valid as long
+ *        as the Retention keeps the snapshot. undo/redo only move the
+ *        current position to the previous/next retained snapshot.
+ *
+ *        Snapshots are dropped as new ones are recorded, a few at a time :
+ *        there is no compaction pass to wait for. The newest snapshot is
+ *        always kept.
+ */
+template <typename State>
+class History
+{
+public:
+    using Handle = uint32_t;
+    using Clock  = std::chrono::steady_clock;
+    static constexpr Handle kNone = UINT32_MAX;
+
+    explicit History(Retention p_retention = Retention::all()) :
+    m_retention(p_retention), m_tiers(std::max<std::size_t>(1, p_retention.tiers))
+    {
+        m_retention.perTier = std::max<std::size_t>(1, m_retention.perTier);
+    }
+
+    /*!
+     * @brief Appends p_state, which becomes the current one.
+     */
+    Handle record(const State& p_state)
+    {
+        Tier& l_newest = m_tiers[0];
+        l_newest.states.push_back(p_state);
+        if ( timed() ) l_newest.times.push_back(Clock::now());
+        m_cursor = {0, l_newest.states.size() - 1};
+        ++m_next;
+
+        if ( l_newest.states.size() > m_retention.perTier ) overflow(0);
+        expire(2);
+        return m_next - 1;
+    }
+
+    /*!
+     * @brief Records a copy of an earlier snapshot, like a new change.
+     */
+    Handle restore(Handle p_handle)
+    {
+        const State* l_state = find(p_handle);
+        if ( !l_state ) return kNone;
+        return record( State(*l_state) );
+    }
+
+    /*!
+     * @brief Moves to the previous/next retained snapshot, if any.
+     * @return Its Handle, or kNone.
+     */
+    Handle undo()
+    {
+        if ( empty() ) return kNone;
+        if ( m_cursor.index > 0 )
+        {
+            --m_cursor.index;
+            return currentHandle();
+        }
+        for ( std::size_t t = m_cursor.tier + 1; t < m_tiers.size(); ++t )
+        {
+            if ( m_tiers[t].states.empty() ) continue;
+            m_cursor = {t, m_tiers[t].states.size() - 1};
+            return currentHandle();
+        }
+        return kNone;
+    }
+
+    Handle redo()
+    {
+        if ( empty() ) return kNone;
+        if ( m_cursor.index + 1 < m_tiers[m_cursor.tier].states.size() )
+        {
+            ++m_cursor.index;
+            return currentHandle();
+        }
+        for ( std::size_t t = m_cursor.tier; t-- > 0; )
+        {
+            if ( m_tiers[t].states.empty() ) continue;
+            m_cursor = {t, 0};
+            return currentHandle();
+        }
+        return kNone;
+    }
+
+    /*!
+     * @brief Drops up to p_budget snapshots out of the time window, for
+     *        callers that record rarely but want the window enforced.
+     */
+    void compact(std::size_t p_budget) { expire(p_budget); }
+
+    /*!
+     * @return The snapshot of p_handle, or nullptr if it is not retained.
+     */
+    const State* find(Handle p_handle) const
+    {
+        if ( p_handle >= m_next ) return nullptr;
+
+        const Tier& l_newest = m_tiers[0];
+        if ( p_handle >= m_next - l_newest.states.size() )
+            return &l_newest.states[p_handle - (m_next - l_newest.states.size())];
+
+        for ( std::size_t t = 1; t < m_tiers.size(); ++t )
+        {
+            const Tier& l_tier = m_tiers[t];
+            if ( l_tier.states.empty() || l_tier.handles.front() > p_handle ) continue;
+
+            std::size_t l_low = 0, l_high = l_tier.handles.size();
+            while ( l_low < l_high )
+            {
+                const std::size_t l_mid = (l_low + l_high) / 2;
+                if ( l_tier.handles[l_mid] < p_handle ) l_low = l_mid + 1;
+                else                                    l_high = l_mid;
+            }
+            return l_low < l_tier.handles.size() && l_tier.handles[l_low] == p_handle
+                 ? &l_tier.states[l_low] : nullptr;
+        }
+        return nullptr;
+    }
+
+    bool         contains(Handle p_handle) const { return find(p_handle) != nullptr; }
+    const State& current() const { return m_tiers[m_cursor.tier].states[m_cursor.index]; }
+    bool         empty() const { return m_tiers[0].states.empty(); }
+
+    Handle currentHandle() const
+    {
+        const Tier& l_tier = m_tiers[m_cursor.tier];
+        return m_cursor.tier == 0 ? static_cast<Handle>(m_next - l_tier.states.size() + m_cursor.index)
+                                  : l_tier.handles[m_cursor.index];
+    }
+
+    std::size_t size() const
+    {
+        std::size_t l_size = 0;
+        for ( const auto& l_tier : m_tiers ) l_size += l_tier.states.size();
+        return l_size;
+    }
+
+    /*!
+     * @brief Bytes of the retained snapshots, without container overhead.
+     */
+    std::size_t memory() const
+    {
+        const std::size_t l_timed = timed() ? sizeof(Clock::time_point) : 0;
+        return size() * (sizeof(State) + l_timed) + (size() - m_tiers[0].states.size()) * sizeof(Handle);
+    }
+
+private:
+    /*!
+     * @brief Oldest first. The handles of the newest tier follow each
+     *        other and are not stored ; times are only kept with a window.
+     */
+    struct Tier
+    {
+        Ring<State>             states;
+        Ring<Handle>            handles;
+        Ring<Clock::time_point> times;
+        uint64_t                overflows{0};
+    };
+
+    struct Cursor
+    {
+        std::size_t tier;
+        std::size_t index;
+    };
+
+    bool timed() const { return m_retention.window != Retention::Window::max(); }
+
+    /*!
+     * @brief Moves the oldest snapshot of tier p_tier to the next tier,
+     *        or drops it.
+     */
+    void overflow(std::size_t p_tier)
+    {
+        Tier&      l_tier    = m_tiers[p_tier];
+        const bool l_keep    = p_tier + 1 < m_tiers.size() && (l_tier.overflows++ & 1) == 0;
+        const bool l_current = m_cursor.tier == p_tier && m_cursor.index == 0;
+
+        if ( l_keep )
+        {
+            Tier& l_next = m_tiers[p_tier + 1];
+            l_next.handles.push_back(p_tier == 0 ? static_cast<Handle>(m_next - l_tier.states.size())
+                                                 : l_tier.handles.front());
+            l_next.states.push_back(std::move(l_tier.states.front()));
+            if ( timed() ) l_next.times.push_back(l_tier.times.front());
+        }
+        popFront(p_tier);
+        if ( l_current && l_keep )
+            m_cursor = {p_tier + 1, m_tiers[p_tier + 1].states.size() - 1};
+
+        if ( l_keep && m_tiers[p_tier + 1].states.size() > m_retention.perTier )
+            overflow(p_tier + 1);
+    }
+
+    /*!
+     * @brief Drops up to p_budget snapshots older than the time window.
+     */
+    void expire(std::size_t p_budget)
+    {
+        if ( !timed() ) return;
+
+        const auto l_limit = Clock::now() - m_retention.window;
+        for ( std::size_t t = m_tiers.size(); t-- > 0 && p_budget; )
+        {
+            Tier& l_tier = m_tiers[t];
+            while ( p_budget && !l_tier.times.empty() && l_tier.times.front() < l_limit && size() > 1 )
+            {
+                popFront(t);
+                --p_budget;
+            }
+            if ( !l_tier.states.empty() ) return;   // Newer tiers are younger
+        }
+    }
+
+    /*!
+     * @brief Drops the oldest snapshot of p_tier ; if it was the current
+     *        one, the next retained snapshot becomes current.
+     */
+    void popFront(std::size_t p_tier)
+    {
+        Tier& l_tier = m_tiers[p_tier];
+        l_tier.states.pop_front();
+        if ( p_tier > 0 ) l_tier.handles.pop_front();
+        if ( timed()    ) l_tier.times.pop_front();
+
+        if ( m_cursor.tier != p_tier ) return;
+        if ( m_cursor.index > 0 )
+        {
+            --m_cursor.index;
+            return;
+        }
+        for ( std::size_t t = p_tier + 1; t-- > 0; )
+        {
+            if ( m_tiers[t].states.empty() ) continue;
+            m_cursor = {t, 0};
+            return;
+        }
+    }
+
+    Retention         m_retention;
+    std::vector<Tier> m_tiers;     /*!< Newest first */
+    Cursor            m_cursor{0, 0};
+    Handle            m_next{0};   /*!< Handle of the next snapshot */
+};
+
+/*!
+ * @brief Originator
+ *        Same account as BankAccount, its history kept by a History
+ *        CareTaker : operations return Handles rather than Mementos.
+ */
+class CompactBankAccount
+{
+public:
+    using Handle = History<int32_t>::Handle;
+    static constexpr Handle kNone = History<int32_t>::kNone;
+
+    CompactBankAccount(const int32_t p_balance, Retention p_retention = Retention::all()) :
+    m_balance(p_balance), m_history(p_retention)
+    {
+        m_history.record(m_balance);
+    }
+
+    Handle deposit(int32_t p_amount)
+    {
+        m_balance += p_amount;
+        return m_history.record(m_balance);
+    }
+
+    Handle restore(Handle p_handle)
+    {
+        const Handle l_handle = m_history.restore(p_handle);
+        if ( l_handle != kNone ) m_balance = m_history.current();
+        return l_handle;
+    }
+
+    Handle undo()
+    {
+        const Handle l_handle = m_history.undo();
+        if ( l_handle != kNone ) m_balance = m_history.current();
+        return l_handle;
+    }
+
+    Handle redo()
+    {
+        const Handle l_handle = m_history.redo();
+        if ( l_handle != kNone ) m_balance = m_history.current();
+        return l_handle;
+    }
+
+    int32_t                  balance() const { return m_balance; }
+    const History<int32_t>&  history() const { return m_history; }
+
+    friend std::ostream& operator<<(std::ostream &p_os, const CompactBankAccount &p_ac)
+    {
+        return p_os << "balance: " << p_ac.m_balance;
+    }
+
+private:
+    int32_t          m_balance{0};
+    History<int32_t> m_history;
+};
+
+/*!
+ * @brief DeltaHistory
+ *        CareTaker for large Originators : a full copy of the state - a
+ *        keyframe - every K versions, and in between only the bytes that
+ *        changed, XOR-ed with their previous value.
+ *
+ *        A XOR delta applies both ways, so restoring a version starts from
+ *        whichever is cheapest of the current state, the keyframe before
+ *        it and the keyframe after it : never more than K/2 deltas away
+ *        from a keyframe. Versions are appended like History snapshots and
+ *        referenced by their rank.
+ *
+ *        Document is a contiguous container of trivially copyable elements
+ *        (std::string, std::vector<uint8_t>...), of less than 4 GiB.
+ *        Past the end of a shorter version, elements count as zeros.
+ */
+template <typename Document>
+class DeltaHistory
+{
+    using Element = typename Document::value_type;
+    static_assert(std::is_trivially_copyable<Element>::value, "DeltaHistory diffs the bytes of the elements");
+
+public:
+    using Version = uint32_t;
+    using Clock   = std::chrono::steady_clock;
+    static constexpr Version kNone = UINT32_MAX;
+
+    struct Stats
+    {
+        std::size_t versions{0};
+        std::size_t keyframes{0};
+        std::size_t keyframeBytes{0};
+        std::size_t deltaBytes{0};
+        double      bytesPerVersion{0};  /*!< memory() / versions */
+        std::size_t restores{0};
+        double      restoreNs{0};        /*!< Mean */
+        double      maxRestoreNs{0};
+        double      deltasPerRestore{0};
+    };
+
+    explicit DeltaHistory(std::size_t p_keyframeInterval = 64) :
+    m_interval(std::max<std::size_t>(1, p_keyframeInterval)) {}
+
+    /*!
+     * @brief Appends p_state as the newest version, which becomes the current one.
+     * @param p_from, p_to When the current version is the newest one, the
+     *        elements of p_state that may differ from it : the rest is not
+     *        compared. A change of size is always accounted for.
+     */
+    Version record(const Document& p_state, std::size_t p_from = 0, std::size_t p_to = SIZE_MAX)
+    {
+        const Version     l_version = static_cast<Version>(m_entries.size());
+        const std::size_t l_old     = bytes(m_newest.size());
+        const std::size_t l_new     = bytes(p_state.size());
+
+        std::size_t l_from = 0, l_to = std::max(l_old, l_new);
+        if ( m_current + 1 == m_entries.size() )
+        {
+            l_from = std::min(bytes(std::min(p_from, p_state.size())), std::min(l_old, l_new));
+            if ( l_old == l_new ) l_to = bytes(std::min(p_to, p_state.size()));
+        }
+
+        if ( l_version > 0 ) encode(p_state, l_from, l_to);
+        m_entries.push_back({static_cast<uint64_t>(m_deltas.size()), static_cast<uint64_t>(p_state.size())});
+        if ( l_version % m_interval == 0 ) m_keyframes.push_back(p_state);
+
+        m_newest.resize(p_state.size());
+        if ( l_to > l_from && l_from < l_new )
+            std::memcpy(raw(m_newest) + l_from, raw(p_state) + l_from, std::min(l_to, l_new) - l_from);
+        m_current = l_version;
+        return l_version;
+    }
+
+    /*!
+     * @brief Turns p_state, which must hold the current version, into p_version.
+     * @return p_version, or kNone if there is no such version.
+     */
+    Version restore(Version p_version, Document& p_state)
+    {
+        if ( p_version >= m_entries.size() ) return kNone;
+        const auto l_start = Clock::now();
+
+        // Cost of each starting point, see span()
+        Version     l_from = m_current;
+        std::size_t l_cost = span(m_current, p_version);
+
+        const Version l_below = static_cast<Version>(p_version / m_interval * m_interval);
+        const Version l_above = static_cast<Version>(l_below + m_interval);
+        if ( bytes(m_entries[l_below].size) + span(l_below, p_version) < l_cost )
+        {
+            l_from = l_below;
+            l_cost = bytes(m_entries[l_below].size) + span(l_below, p_version);
+        }
+        if ( l_above < m_entries.size() && bytes(m_entries[l_above].size) + span(p_version, l_above) < l_cost )
+            l_from = l_above;
+
+        if ( l_from != m_current ) p_state = m_keyframes[l_from / m_interval];
+        for ( Version v = l_from + 1; v <= p_version; ++v ) apply(v, p_state, m_entries[v].size);
+        for ( Version v = l_from; v > p_version; --v ) apply(v, p_state, m_entries[v - 1].size);
+        m_deltasApplied += l_from < p_version ? p_version - l_from : l_from - p_version;
+        m_current        = p_version;
+
+        const double l_ns = std::chrono::duration<double, std::nano>(Clock::now() - l_start).count();
+        m_restoreNs    += l_ns;
+        m_maxRestoreNs  = std::max(m_maxRestoreNs, l_ns);
+        ++m_restores;
+        return p_version;
+    }
+
+    Version undo(Document& p_state) { return m_current > 0 && m_current != kNone ? restore(m_current - 1, p_state) : kNone; }
+    Version redo(Document& p_state) { return m_current + 1 < m_entries.size() ? restore(m_current + 1, p_state) : kNone; }
+
+    Version     current() const { return m_current; }
+    std::size_t size()    const { return m_entries.size(); }
+    bool        empty()   const { return m_entries.empty(); }
+
+    /*!
+     * @brief Bytes of the keyframes, deltas, index and copy of the newest
+     *        version, without container overhead.
+     */
+    std::size_t memory() const
+    {
+        return keyframeBytes() + m_deltas.size() + m_entries.size() * sizeof(Entry) + bytes(m_newest.size());
+    }
+
+    Stats stats() const
+    {
+        Stats l_stats;
+        l_stats.versions         = m_entries.size();
+        l_stats.keyframes        = m_keyframes.size();
+        l_stats.keyframeBytes    = keyframeBytes();
+        l_stats.deltaBytes       = m_deltas.size();
+        l_stats.bytesPerVersion  = empty() ? 0. : double(memory()) / m_entries.size();
+        l_stats.restores         = m_restores;
+        l_stats.restoreNs        = m_restores ? m_restoreNs / m_restores : 0.;
+        l_stats.maxRestoreNs     = m_maxRestoreNs;
+        l_stats.deltasPerRestore = m_restores ? double(m_deltasApplied) / m_restores : 0.;
+        return l_stats;
+    }
+
+private:
+    /*!
+     * @brief Delta v, from version v-1 to v, spans m_deltas from the end
+     *        of delta v-1 to end : runs of a uint32_t byte offset, a
+     *        uint32_t length, then the XOR-ed bytes.
+     */
+    struct Entry
+    {
+        uint64_t end;
+        uint64_t size;  /*!< Elements */
+    };
+
+    /*!
+     * @brief Equal bytes worth a new run rather than extending the current one.
+     */
+    static constexpr std::size_t kGap = 2 * sizeof(uint32_t);
+
+    /*!
+     * @brief Applying a delta costs about as much as copying that many
+     *        more bytes : a long walk loses against copying a keyframe.
+     */
+    static constexpr std::size_t kDeltaCost = 1024;
+
+    static std::size_t    bytes(std::size_t p_elements) { return p_elements * sizeof(Element); }
+    static const uint8_t* raw(const Document& p_doc) { return reinterpret_cast<const uint8_t*>(p_doc.data()); }
+    static uint8_t*       raw(Document& p_doc)       { return reinterpret_cast<uint8_t*>(&p_doc[0]); }
+
+    std::size_t keyframeBytes() const
+    {
+        std::size_t l_bytes = 0;
+        for ( const auto& l_keyframe : m_keyframes ) l_bytes += bytes(l_keyframe.size());
+        return l_bytes;
+    }
+
+    /*!
+     * @brief Cost of applying the deltas between versions p_a and p_b,
+     *        in bytes copied : their size, plus kDeltaCost each.
+     */
+    std::size_t span(Version p_a, Version p_b) const
+    {
+        if ( p_a > p_b ) std::swap(p_a, p_b);
+        return m_entries[p_b].end - m_entries[p_a].end + (p_b - p_a) * kDeltaCost;
+    }
+
+    /*!
+     * @brief Appends the runs where p_state differs from m_newest, within
+     *        [p_from, p_to) bytes.
+     */
+    void encode(const Document& p_state, std::size_t p_from, std::size_t p_to)
+    {
+        const uint8_t*    l_new   = raw(p_state);
+        const std::size_t l_bytes = bytes(p_state.size());
+        m_newest.resize(std::max(m_newest.size(), p_state.size()));
+        const uint8_t*    l_old   = raw(m_newest);
+        auto l_at = [&](std::size_t i) -> uint8_t { return i < l_bytes ? l_new[i] : 0; };
+
+        std::size_t i = p_from;
+        while ( i < p_to )
+        {
+            for ( uint64_t a, b; i + sizeof(uint64_t) <= std::min(p_to, l_bytes); i += sizeof(uint64_t) )
+            {
+                std::memcpy(&a, l_old + i, sizeof a);
+                std::memcpy(&b, l_new + i, sizeof b);
+                if ( a != b ) break;
+            }
+            while ( i < p_to && l_old[i] == l_at(i) ) ++i;
+            if ( i == p_to ) break;
+
+            std::size_t l_end = i + 1;
+            for ( std::size_t j = l_end; j < p_to && j - l_end < kGap; ++j )
+                if ( l_old[j] != l_at(j) ) l_end = j + 1;
+
+            const uint32_t l_run[2] = {static_cast<uint32_t>(i), static_cast<uint32_t>(l_end - i)};
+            const std::size_t l_at0 = m_deltas.size();
+            m_deltas.resize(l_at0 + sizeof l_run + (l_end - i));
+            std::memcpy(&m_deltas[l_at0], l_run, sizeof l_run);
+            for ( std::size_t j = i; j < l_end; ++j )
+                m_deltas[l_at0 + sizeof l_run + (j - i)] = l_old[j] ^ l_at(j);
+            i = l_end;
+        }
+    }
+
+    /*!
+     * @brief XORs delta p_version into p_state, leaving it p_size elements long.
+     */
+    void apply(Version p_version, Document& p_state, std::size_t p_size) const
+    {
+        p_state.resize(std::max(m_entries[p_version - 1].size, m_entries[p_version].size));
+        uint8_t* l_state = raw(p_state);
+
+        for ( std::size_t l_at = m_entries[p_version - 1].end; l_at < m_entries[p_version].end; )
+        {
+            uint32_t l_run[2];
+            std::memcpy(l_run, &m_deltas[l_at], sizeof l_run);
+            l_at += sizeof l_run;
+            for ( uint32_t j = 0; j < l_run[1]; ++j ) l_state[l_run[0] + j] ^= m_deltas[l_at + j];
+            l_at += l_run[1];
+        }
+        p_state.resize(p_size);
+    }
+
+    std::size_t           m_interval;
+    std::vector<Entry>    m_entries;               /*!< Version -> delta and size */
+    std::vector<uint8_t>  m_deltas;
+    std::vector<Document> m_keyframes;             /*!< Versions 0, K, 2K...      */
+    Document              m_newest;                /*!< What the next delta is computed against */
+    Version               m_current{kNone};
+
+    std::size_t           m_restores{0};
+    std::size_t           m_deltasApplied{0};
+    double                m_restoreNs{0};
+    double                m_maxRestoreNs{0};
+};
+
+/*!
+ * @brief Originator
+ *        A large text, its versions kept by a DeltaHistory : every write()
+ *        is a version, and only the written range is diffed.
+ */
+class Document
 {
+public:
+    using Version = DeltaHistory<std::string>::Version;
+    static constexpr Version kNone = DeltaHistory<std::string>::kNone;
+
+    explicit Document(std::string p_text, std::size_t p_keyframeInterval = 64) :
+    m_text(std::move(p_text)), m_history(p_keyframeInterval)
+    {
+        m_history.record(m_text);
+    }
+
+    /*!
+     * @brief Overwrites the text from p_offset, extending it with spaces if needed.
+     */
+    Version write(std::size_t p_offset, const std::string& p_text)
+    {
+        if ( m_text.size() < p_offset + p_text.size() ) m_text.resize(p_offset + p_text.size(), ' ');
+        m_text.replace(p_offset, p_text.size(), p_text);
+        return m_history.record(m_text, p_offset, p_offset + p_text.size());
+    }
+
+    Version restore(Version p_version) { return m_history.restore(p_version, m_text); }
+    Version undo()                     { return m_history.undo(m_text); }
+    Version redo()                     { return m_history.redo(m_text); }
+
+    const std::string&                 text()    const { return m_text; }
+    const DeltaHistory<std::string>&   history() const { return m_history; }
+
+private:
+    std::string               m_text;
+    DeltaHistory<std::string> m_history;
+};
+
+/*!
+ * @brief PersistentVector
+ *        Immutable vector : set() and push_back() return a new vector
+ *        and leave this one untouched. Elements live in the leaves of a
+ *        32-way tree ; a change copies the nodes on the path to its leaf
+ *        and shares all the others with the previous vector, so a copy is
+ *        O(1) and a change is O(log32 n).
+ */
+template <typename T>
+class PersistentVector
+{
+    static constexpr unsigned    kBits  = 5;
+    static constexpr std::size_t kWidth = std::size_t{1} << kBits;
+    static constexpr std::size_t kMask  = kWidth - 1;
+
+    using Ptr = std::shared_ptr<const void>;    /*!< Inner or Leaf, depending on the level */
+    struct Inner { Ptr children[kWidth]; };
+    struct Leaf  { T   values[kWidth]{}; };
+
+public:
+    PersistentVector() = default;
+
+    /*!
+     * @brief p_size copies of p_value : equal subtrees are shared, only
+     *        a few nodes per level are allocated.
+     */
+    PersistentVector(std::size_t p_size, const T& p_value) : m_size(p_size)
+    {
+        if ( p_size == 0 ) return;
+        while ( (kWidth << m_shift) < p_size ) m_shift += kBits;
+        m_root = fill(m_shift, p_size, p_value);
+    }
+
+    std::size_t size()  const { return m_size; }
+    bool        empty() const { return m_size == 0; }
+
+    const T& operator[](std::size_t i) const
+    {
+        const void* l_node = m_root.get();
+        for ( unsigned l_shift = m_shift; l_shift > 0; l_shift -= kBits )
+            l_node = static_cast<const Inner*>(l_node)->children[(i >> l_shift) & kMask].get();
+        return static_cast<const Leaf*>(l_node)->values[i & kMask];
+    }
+
+    PersistentVector set(std::size_t i, T p_value) const
+    {
+        PersistentVector l_result(*this);
+        l_result.m_root = assoc(m_root.get(), m_shift, i, std::move(p_value));
+        return l_result;
+    }
+
+    PersistentVector push_back(T p_value) const
+    {
+        PersistentVector l_result(*this);
+        if ( m_root && m_size == (kWidth << m_shift) )
+        {
+            auto l_root = std::make_shared<Inner>();
+            l_root->children[0] = m_root;
+            l_result.m_root   = std::move(l_root);
+            l_result.m_shift += kBits;
+        }
+        l_result.m_root = assoc(l_result.m_root.get(), l_result.m_shift, m_size, std::move(p_value));
+        ++l_result.m_size;
+        return l_result;
+    }
+
+    /*!
+     * @brief Whether both vectors are the same version : O(1).
+     */
+    bool sameAs(const PersistentVector& p_other) const { return m_root == p_other.m_root && m_size == p_other.m_size; }
+
+private:
+    /*!
+     * @brief Copy of p_node (nullptr : a new node) with element i set,
+     *        and the path below it copied likewise.
+     */
+    static Ptr assoc(const void* p_node, unsigned p_shift, std::size_t i, T p_value)
+    {
+        if ( p_shift == 0 )
+        {
+            auto l_leaf = p_node ? std::make_shared<Leaf>(*static_cast<const Leaf*>(p_node)) : std::make_shared<Leaf>();
+            l_leaf->values[i & kMask] = std::move(p_value);
+            return l_leaf;
+        }
+        auto  l_inner = p_node ? std::make_shared<Inner>(*static_cast<const Inner*>(p_node)) : std::make_shared<Inner>();
+        Ptr&  l_child = l_inner->children[(i >> p_shift) & kMask];
+        l_child = assoc(l_child.get(), p_shift - kBits, i, std::move(p_value));
+        return l_inner;
+    }
+
+    /*!
+     * @brief Subtree of level p_shift holding p_size copies of p_value :
+     *        its full children are all the same node.
+     */
+    static Ptr fill(unsigned p_shift, std::size_t p_size, const T& p_value)
+    {
+        if ( p_shift == 0 )
+        {
+            auto l_leaf = std::make_shared<Leaf>();
+            std::fill(l_leaf->values, l_leaf->values + p_size, p_value);
+            return l_leaf;
+        }
+        const std::size_t l_child = kWidth << (p_shift - kBits);
+        auto l_inner = std::make_shared<Inner>();
+        Ptr  l_full  = p_size >= l_child ? fill(p_shift - kBits, l_child, p_value) : nullptr;
+        for ( std::size_t c = 0; c * l_child < p_size; ++c )
+            l_inner->children[c] = p_size - c * l_child >= l_child ? l_full
+                                                                   : fill(p_shift - kBits, p_size - c * l_child, p_value);
+        return l_inner;
+    }
+
+    Ptr         m_root;
+    unsigned    m_shift{0};  /*!< Bits of the index below the root level */
+    std::size_t m_size{0};
+};
+
+/*!
+ * @brief Originator
+ *        Balances of many accounts, held in a PersistentVector : every
+ *        deposit makes a new version sharing all the untouched nodes with
+ *        the previous one. The version is its own Memento, so taking one
+ *        is O(1) and restoring it is a root swap.
+ */
+class Ledger
+{
+public:
+    using Memento = PersistentVector<int32_t>;
+
+    Ledger(std::size_t p_accounts, int32_t p_balance) : m_balances(p_accounts, p_balance)
+    {
+        m_changes.push_back(m_balances);
+    }
+
+    Memento deposit(std::size_t p_account, int32_t p_amount)
+    {
+        m_balances = m_balances.set(p_account, m_balances[p_account] + p_amount);
+        m_changes.push_back(m_balances);
+        m_current = m_changes.size() - 1;
+        return m_balances;
+    }
+
+    void restore(const Memento& p_memento)
+    {
+        m_balances = p_memento;
+        m_changes.push_back(p_memento);
+        m_current = m_changes.size() - 1;
+    }
+
+    /*!
+     * @return Whether there was a version to go back/forward to.
+     */
+    bool undo()
+    {
+        if ( m_current == 0 ) return false;
+        m_balances = m_changes[--m_current];
+        return true;
+    }
+
+    bool redo()
+    {
+        if ( m_current + 1 >= m_changes.size() ) return false;
+        m_balances = m_changes[++m_current];
+        return true;
+    }
+
+    int32_t        balance(std::size_t p_account) const { return m_balances[p_account]; }
+    const Memento& balances() const { return m_balances; }
+
+private:
+    Memento              m_balances;
+    std::size_t          m_current{0};
+    std::vector<Memento> m_changes;
+};
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+double nsPer(Clock::time_point p_start, std::size_t p_count)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - p_start).count() / p_count;
+}
+
+/*!
+ * @brief Heap bytes in use, as counted by the operator new below
+ *        (always 0 without MEMENTO_BENCH).
+ */
+std::size_t g_liveBytes = 0;
+
+/*!
+ * @brief 100k accounts with 100 deposits each, with shared Mementos
+ *        and with a History.
+ */
+void compactHistory()
+{
+    const std::size_t l_accounts = 100000;
+    const int         l_deposits = 100;
+    const std::size_t l_states   = l_accounts * (l_deposits + 1);
+
+    std::size_t l_before = g_liveBytes;
+    auto        l_start  = Clock::now();
+    std::vector<BankAccount> l_shared;
+    l_shared.reserve(l_accounts);
+    for ( std::size_t a = 0; a < l_accounts; ++a )
+    {
+        l_shared.emplace_back(1000);
+        for ( int d = 0; d < l_deposits; ++d ) l_shared.back().deposit(d);
+    }
+    const double      l_sharedRecordNs = nsPer(l_start, l_states);
+    const std::size_t l_sharedBytes    = g_liveBytes - l_before;
+
+    l_start = Clock::now();
+    for ( auto& l_acc : l_shared ) { for ( int d = 0; d < l_deposits; ++d ) l_acc.undo(); }
+    for ( auto& l_acc : l_shared ) { for ( int d = 0; d < l_deposits; ++d ) l_acc.redo(); }
+    const double l_sharedUndoNs = nsPer(l_start, 2 * l_accounts * l_deposits);
+
+    l_before = g_liveBytes;
+    l_start  = Clock::now();
+    std::vector<CompactBankAccount> l_compact;
+    l_compact.reserve(l_accounts);
+    for ( std::size_t a = 0; a < l_accounts; ++a )
+    {
+        l_compact.emplace_back(1000);
+        for ( int d = 0; d < l_deposits; ++d ) l_compact.back().deposit(d);
+    }
+    const double      l_compactRecordNs = nsPer(l_start, l_states);
+    const std::size_t l_compactBytes    = g_liveBytes - l_before;
+
+    l_start = Clock::now();
+    for ( auto& l_acc : l_compact ) { for ( int d = 0; d < l_deposits; ++d ) l_acc.undo(); }
+    for ( auto& l_acc : l_compact ) { for ( int d = 0; d < l_deposits; ++d ) l_acc.redo(); }
+    const double l_compactUndoNs = nsPer(l_start, 2 * l_accounts * l_deposits);
+
+    std::printf("history accounts=%zu states=%zu : shared Mementos %5.1f B/state, %5.1f ns/record, %4.1f ns/undo-redo"
+                " ; History %4.1f B/state, %4.1f ns/record, %4.1f ns/undo-redo\n",
+                l_accounts, l_states,
+                double(l_sharedBytes) / l_states, l_sharedRecordNs, l_sharedUndoNs,
+                double(l_compactBytes) / l_states, l_compactRecordNs, l_compactUndoNs);
+}
+
+/*!
+ * @brief 10M records under each Retention : what is kept, how long the
+ *        slowest record took, and an undo/redo walk over what is kept.
+ */
+void retention()
+{
+    using namespace std::chrono_literals;
+    const uint32_t l_records = 10000000;
+
+    const std::pair<const char*, Retention> l_policies[] =
+    {
+        {"all",            Retention::all()                     },
+        {"last 1000",      Retention::lastN(1000)               },
+        {"exp 256x16",     Retention::exponential(256, 16)      },
+        {"window 1ms",     Retention::timeWindow(1ms, 1 << 20)  },
+    };
+
+    for ( const auto& l_policy : l_policies )
+    {
+        History<int32_t> l_history(l_policy.second);
+
+        std::vector<float> l_latencies(l_records);
+        auto l_start = Clock::now();
+        for ( uint32_t i = 0; i < l_records; ++i )
+        {
+            const auto l_before = Clock::now();
+            l_history.record(static_cast<int32_t>(i));
+            l_latencies[i] = std::chrono::duration<float, std::nano>(Clock::now() - l_before).count();
+        }
+        const double l_recordNs = nsPer(l_start, l_records);
+
+        auto l_p9999 = std::begin(l_latencies) + l_records / 10000 * 9999;
+        std::nth_element(std::begin(l_latencies), l_p9999, std::end(l_latencies));
+        const double l_tailNs = *l_p9999;
+        const double l_maxNs  = *std::max_element(l_p9999, std::end(l_latencies));
+
+        // Each state is its own handle : check them while walking back and forth.
+        bool        l_consistent = true;
+        std::size_t l_steps      = 0;
+        uint32_t    l_previous   = l_history.currentHandle();
+        l_start = Clock::now();
+        for ( History<int32_t>::Handle h; (h = l_history.undo()) != History<int32_t>::kNone; ++l_steps )
+        {
+            l_consistent &= h < l_previous && l_history.current() == static_cast<int32_t>(h);
+            l_previous = h;
+        }
+        for ( History<int32_t>::Handle h; (h = l_history.redo()) != History<int32_t>::kNone; ++l_steps )
+        {
+            l_consistent &= h > l_previous && l_history.current() == static_cast<int32_t>(h);
+            l_previous = h;
+        }
+        const double l_walkNs = nsPer(l_start, std::max<std::size_t>(1, l_steps));
+
+        for ( uint32_t h = 0; h < l_records; h += 997 )
+        {
+            const int32_t* l_state = l_history.find(h);
+            l_consistent &= !l_state || *l_state == static_cast<int32_t>(h);
+        }
+
+        std::printf("retention %-10s kept %8zu (%9zu B) : record %5.1f ns mean, %7.1f us p99.99, %8.1f us max ;"
+                    " undo/redo %4.1f ns (consistent : %s)\n",
+                    l_policy.first, l_history.size(), l_history.memory(), l_recordNs, l_tailNs / 1e3, l_maxNs / 1e3,
+                    l_walkNs, l_consistent ? "yes" : "no");
+    }
+}
+
+/*!
+ * @brief A 4 MB Document edited 100k times - 64 bytes overwritten at
+ *        random, and every 1000th edit appends 4 KB - under several
+ *        keyframe intervals, then random restores and an undo/redo walk.
+ */
+void deltaHistory()
+{
+    const std::size_t l_size     = 4 << 20;
+    const uint32_t    l_versions = 100000;
+    const uint32_t    l_restores = 2000;
+
+    std::vector<std::pair<Document::Version, std::string>> l_expected;  // Sampled versions, by copy
+    for ( std::size_t l_interval : {256, 1024, 4096} )
+    {
+        std::mt19937 l_rng{42};
+        std::string  l_text(l_size, ' ');
+        for ( auto& c : l_text ) c = static_cast<char>('a' + l_rng() % 26);
+
+        const std::size_t l_before = g_liveBytes;
+        Document          l_doc(std::move(l_text), l_interval);
+        const bool        l_sample = l_expected.empty();
+        std::size_t       l_sampled = 0;
+
+        auto l_start = Clock::now();
+        for ( uint32_t v = 1; v < l_versions; ++v )
+        {
+            std::string l_edit(v % 1000 ? 64 : 4096, static_cast<char>('A' + v % 26));
+            l_doc.write(v % 1000 ? l_rng() % (l_doc.text().size() - 64) : l_doc.text().size(), l_edit);
+            if ( l_sample && v % 3001 == 0 )
+            {
+                const std::size_t l_copied = g_liveBytes;
+                l_expected.emplace_back(v, l_doc.text());
+                l_sampled += g_liveBytes - l_copied;
+            }
+        }
+        const double      l_recordNs = nsPer(l_start, l_versions - 1);
+        const std::size_t l_heap     = g_liveBytes - l_before - l_sampled;
+
+        Document::Version l_last = l_doc.history().current();
+        for ( uint32_t i = 0; i < l_restores; ++i ) l_doc.restore(l_rng() % l_versions);
+        const auto l_random = l_doc.history().stats();
+
+        l_doc.restore(l_last);
+        l_start = Clock::now();
+        uint32_t l_steps = 0;
+        for ( ; l_steps < 1000 && l_doc.undo() != Document::kNone; ++l_steps ) {}
+        for ( uint32_t i = 0; i < l_steps; ++i ) l_doc.redo();
+        const double l_walkNs = nsPer(l_start, std::max<uint32_t>(1, 2 * l_steps));
+
+        bool l_consistent = l_doc.history().current() == l_last;
+        for ( const auto& l_version : l_expected )
+        {
+            l_doc.restore(l_version.first);
+            l_consistent &= l_doc.text() == l_version.second;
+        }
+
+        std::printf("delta K=%-4zu versions=%u : %3zu keyframes %6.1f MB + deltas %5.1f MB = %7.1f B/version (heap %6.1f MB) ;"
+                    " record %6.1f ns ; restore %6.1f us mean, %6.1f us max, %5.1f deltas ; undo/redo %5.1f ns (consistent : %s)\n",
+                    l_interval, l_versions, l_random.keyframes, l_random.keyframeBytes / 1e6, l_random.deltaBytes / 1e6,
+                    l_random.bytesPerVersion, l_heap / 1e6, l_recordNs,
+                    l_random.restoreNs / 1e3, l_random.maxRestoreNs / 1e3, l_random.deltasPerRestore,
+                    l_walkNs, l_consistent ? "yes" : "no");
+    }
+
+    // What copying Mementos would cost instead
+    std::string l_state(l_size, 'x');
+    std::vector<std::string> l_copies;
+    auto l_start = Clock::now();
+    for ( int i = 0; i < 64; ++i ) { l_state[i] = 'y'; l_copies.push_back(l_state); }
+    std::printf("delta full copies : %.1f us/record, %zu B/version, %.0f GB for %u versions\n",
+                nsPer(l_start, 64) / 1e3, l_size, double(l_size) * l_versions / 1e9, l_versions);
+}
+
+/*!
+ * @brief 4096 deposits over a Ledger, against copying all the balances
+ *        into a Memento at each deposit. The copies are capped at 256 MB :
+ *        their cost per version does not depend on how many there are.
+ */
+void persistentLedger()
+{
+    const uint32_t l_deposits = 4096;
+
+    for ( std::size_t l_accounts : {std::size_t{1} << 10, std::size_t{1} << 16, std::size_t{1} << 20} )
+    {
+        const std::size_t l_copies = std::min<std::size_t>(l_deposits, (256u << 20) / (l_accounts * sizeof(int32_t)));
+        std::mt19937      l_rng{42};
+
+        // Copy everything
+        std::size_t l_before = g_liveBytes;
+        std::vector<int32_t>              l_balances(l_accounts, 1000);
+        std::vector<std::vector<int32_t>> l_copied;
+        l_copied.reserve(l_copies + 1);
+        l_copied.push_back(l_balances);
+        auto l_start = Clock::now();
+        for ( std::size_t d = 0; d < l_copies; ++d )
+        {
+            l_balances[l_rng() % l_accounts] += d % 100;
+            l_copied.push_back(l_balances);
+        }
+        const double      l_copyNs    = nsPer(l_start, l_copies);
+        const std::size_t l_copyBytes = (g_liveBytes - l_before) / (l_copies + 1);
+
+        l_start = Clock::now();
+        for ( std::size_t v = l_copies; v-- > 0; ) l_balances = l_copied[v];
+        const double l_copyRestoreNs = nsPer(l_start, l_copies);
+
+        // Share the untouched nodes
+        l_rng.seed(42);
+        l_before = g_liveBytes;
+        Ledger l_ledger(l_accounts, 1000);
+        const std::size_t l_baseBytes = g_liveBytes - l_before;
+        l_start = Clock::now();
+        for ( std::size_t d = 0; d < l_deposits; ++d ) l_ledger.deposit(l_rng() % l_accounts, d % 100);
+        const double      l_depositNs  = nsPer(l_start, l_deposits);
+        const std::size_t l_sharedBytes = g_liveBytes - l_before - l_baseBytes;
+
+        l_start = Clock::now();
+        std::size_t l_steps = 0;
+        for ( ; l_ledger.undo(); ++l_steps ) {}
+        const double l_undoNs = nsPer(l_start, std::max<std::size_t>(1, l_steps));
+
+        // Same balances at each of the copied versions
+        bool l_consistent = l_steps == l_deposits;
+        for ( std::size_t v = 0; v <= l_copies && l_consistent; ++v )
+        {
+            for ( std::size_t a = 0; a < l_accounts; ++a ) l_consistent &= l_ledger.balance(a) == l_copied[v][a];
+            l_ledger.redo();
+        }
+
+        std::printf("persistent accounts=%-7zu : copies %9zu B/version, %8.1f ns/deposit, %8.1f ns/restore ;"
+                    " Ledger %7zu B initial, %6.1f B/version, %6.1f ns/deposit, %4.1f ns/restore (consistent : %s)\n",
+                    l_accounts, l_copyBytes, l_copyNs, l_copyRestoreNs,
+                    l_baseBytes, double(l_sharedBytes) / l_deposits, l_depositNs, l_undoNs, l_consistent ? "yes" : "no");
+    }
+}
+
+} // namespace bench
+
+#ifdef MEMENTO_BENCH
+/*!
+ * @brief Heap accounting for the benchmarks. Kept out of line : GCC would
+ *        otherwise see the free() of a pointer from operator new.
+ */
+__attribute__((noinline)) void* operator new(std::size_t p_size)
+{
+    void* l_ptr = std::malloc(p_size ? p_size : 1);
+    if ( !l_ptr ) throw std::bad_alloc();
+    bench::g_liveBytes += malloc_usable_size(l_ptr);
+    return l_ptr;
+}
+
+__attribute__((noinline)) void operator delete(void* p_ptr) noexcept
+{
+    if ( p_ptr ) bench::g_liveBytes -= malloc_usable_size(p_ptr);
+    std::free(p_ptr);
+}
+
+void operator delete(void* p_ptr, std::size_t) noexcept { operator delete(p_ptr); }
+#endif
+
+int main(int argc, char** argv)
+{
+    if ( argc > 1 && std::strcmp(argv[1], "--bench") == 0 )
+    {
+#ifndef MEMENTO_BENCH
+        std::fprintf(stderr, "built without MEMENTO_BENCH : heap figures read 0\n");
+#endif
+        bench::compactHistory();
+        bench::retention();
+        bench::deltaHistory();
+        bench::persistentLedger();
+        return EXIT_SUCCESS;
+    }
+
     BankAccount myAcc{1000};
     myAcc.deposit(200);
     myAcc.deposit( 50);
@@ -1,12 +1,353 @@
 /*!
  * Example largely inspired by
  * http://www.vishalchovatiya.com/observer-design-pattern-in-modern-cpp
+ *
+ * Run with --bench to measure notifications instead of running the example.
  */
 
 #include <iostream>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <ctime>
+
+/*!
+ * @brief FieldTraits
+ *        Specialized by each Subject type to name its observable fields :
+ *          - Field  : an enumeration of the fields, from 0.
+ *          - kCount : how many there are (at most 64).
+ */
+template <typename T>
+struct FieldTraits;
+
+/*!
+ * @brief Whether the getters of T may be called while T is being mutated,
+ *        e.g. because its fields are atomics : FieldTraits<T>::kConcurrentReads,
+ *        false if not declared. Required to notify T asynchronously, since
+ *        the Observers then read it from the Dispatcher's threads.
+ */
+template <typename T, typename = void>
+struct ConcurrentReads : std::false_type {};
+
+template <typename T>
+struct ConcurrentReads<T, std::void_t<decltype(FieldTraits<T>::kConcurrentReads)> > :
+std::bool_constant<FieldTraits<T>::kConcurrentReads> {};
+
+/*!
+ * @brief Set of fields of a Subject, one bit per field.
+ */
+using FieldMask = uint64_t;
+constexpr FieldMask kAllFields = ~FieldMask{0};
+
+template <typename... F>
+constexpr FieldMask fieldMask(F... p_fields)
+{
+    return ( FieldMask{0} | ... | (FieldMask{1} << static_cast<unsigned>(p_fields)) );
+}
+
+/*!
+ * @brief Dispatcher
+ *        Work-stealing thread pool running asynchronous notifications.
+ *
+ *        Each worker owns a deque of tasks : it pops its own tasks from
+ *        the back (the most recently posted, still hot) and, once empty,
+ *        steals from the front of the others'. Tasks posted from outside
+ *        the pool are spread round-robin.
+ *
+ *        Each Observer with notifications waiting gets a strand : a task
+ *        delivering its queue in order, so that the Observer is never called
+ *        by two of its threads at once. Strands are allocated on the first
+ *        notification and freed once their queue is drained, so Observers
+ *        pay nothing for it. An Observer notified by several Dispatchers
+ *        may however be called by several threads at once.
+ *
+ *        The Dispatcher also counts the notifications it was handed and
+ *        the time they waited before delivery.
+ */
+class Dispatcher
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /*!
+     * @brief A notification for an Observer of any Subject type :
+     *        deliver() casts the pointers back and makes the call.
+     */
+    struct Notification
+    {
+        void              (*deliver)(const Notification&);
+        void*               observer;
+        void*               src;
+        FieldMask           fields;     /*!< For changed()                  */
+        unsigned            field;      /*!< For update()                   */
+        bool                coalesced;  /*!< changed() rather than update() */
+        Clock::time_point   since;
+    };
+
+    struct Stats
+    {
+        uint64_t depth;          /*!< Notifications not delivered yet   */
+        uint64_t delivered;
+        double   meanLatencyNs;  /*!< From notify to the Observer call  */
+        double   maxLatencyNs;
+    };
+
+    explicit Dispatcher(std::size_t p_threads = std::max(1u, std::thread::hardware_concurrency())) :
+    m_workers(p_threads)
+    {
+        for ( std::size_t i = 0; i < p_threads; ++i )
+            m_threads.emplace_back([this, i] { work(i); });
+    }
+
+    ~Dispatcher()
+    {
+        flush();
+        {
+            std::lock_guard<std::mutex> l_lock(m_idleMutex);
+            m_stop = true;
+        }
+        m_idle.notify_all();
+        for ( auto& l_thread : m_threads )
+            l_thread.join();
+    }
+
+    Dispatcher(const Dispatcher&)            = delete;
+    Dispatcher& operator=(const Dispatcher&) = delete;
+
+    /*!
+     * @brief Queues p_notification behind the other ones of its Observer.
+     */
+    void notify(const Notification& p_notification)
+    {
+        m_pending.fetch_add(1);
+
+        Shard&  l_shard = shard(p_notification.observer);
+        Strand* l_new   = nullptr;
+        {
+            std::lock_guard<std::mutex> l_lock(l_shard.mutex);
+            auto l_it = l_shard.strands.find(p_notification.observer);
+            if ( l_it == std::end(l_shard.strands) )
+            {
+                l_new = new Strand(*this, p_notification.observer);
+                l_it  = l_shard.strands.emplace(p_notification.observer, l_new).first;
+            }
+            l_it->second->queue.push_back(p_notification);
+        }
+        if ( l_new )
+            post(l_new);
+    }
+
+    /*!
+     * @brief Waits until every notification handed so far is delivered.
+     *        Must not be called from an Observer run by this Dispatcher.
+     */
+    void flush()
+    {
+        std::unique_lock<std::mutex> l_lock(m_flushMutex);
+        m_flushed.wait(l_lock, [this] { return m_pending.load() == 0; });
+    }
+
+    Stats stats() const
+    {
+        const uint64_t l_delivered = m_delivered.load();
+        return { m_pending.load(), l_delivered,
+                 l_delivered ? double(m_latencyNs.load()) / l_delivered : 0.,
+                 double(m_maxLatencyNs.load()) };
+    }
+
+private:
+    struct Task
+    {
+        virtual ~Task() = default;
+        virtual void run() = 0;
+    };
+
+    /*!
+     * @brief The queue of an Observer, delivered by one thread at a time.
+     *        Frees itself once drained.
+     */
+    struct Strand : Task
+    {
+        Strand(Dispatcher& p_dispatcher, const void* p_observer) :
+        dispatcher(p_dispatcher), observer(p_observer) {}
+
+        void run() override { dispatcher.drain(*this); }
+
+        Dispatcher&               dispatcher;
+        const void*               observer;
+        std::vector<Notification> queue;    /*!< Guarded by the shard's mutex */
+    };
+
+    /*!
+     * @brief Strands, spread by Observer so that unrelated notifications
+     *        seldom take the same lock.
+     */
+    struct Shard
+    {
+        std::mutex                                mutex;
+        std::unordered_map<const void*, Strand*>  strands;
+    };
+    static constexpr std::size_t kShards = 64;
+
+    Shard& shard(const void* p_observer)
+    {
+        return m_shards[(reinterpret_cast<std::uintptr_t>(p_observer) >> 4) % kShards];
+    }
+
+    void drain(Strand& p_strand)
+    {
+        Shard&                    l_shard = shard(p_strand.observer);
+        std::vector<Notification> l_batch;
+        uint64_t                  l_done = 0;
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> l_lock(l_shard.mutex);
+                if ( p_strand.queue.empty() )
+                {
+                    l_shard.strands.erase(p_strand.observer);
+                    break;
+                }
+                l_batch.swap(p_strand.queue);
+            }
+            for ( const auto& l_notification : l_batch )
+            {
+                l_notification.deliver(l_notification);
+                delivered(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              Clock::now() - l_notification.since).count());
+            }
+            l_done += l_batch.size();
+            l_batch.clear();
+        }
+        delete &p_strand;
+
+        // The Observer is not touched anymore : once released, flush() may return and it may go.
+        released(l_done);
+    }
+
+    void post(Task* p_task)
+    {
+        const std::size_t l_target = t_worker.first == this
+                                   ? t_worker.second
+                                   : m_next.fetch_add(1) % m_workers.size();
+        {
+            std::lock_guard<std::mutex> l_lock(m_workers[l_target].mutex);
+            m_workers[l_target].tasks.push_back(p_task);
+        }
+        {
+            std::lock_guard<std::mutex> l_lock(m_idleMutex);
+            ++m_queued;
+        }
+        m_idle.notify_one();
+    }
+
+    void delivered(uint64_t p_latencyNs)
+    {
+        m_delivered.fetch_add(1);
+        m_latencyNs.fetch_add(p_latencyNs);
+        uint64_t l_max = m_maxLatencyNs.load();
+        while ( p_latencyNs > l_max && !m_maxLatencyNs.compare_exchange_weak(l_max, p_latencyNs) ) {}
+    }
+
+    /*!
+     * @brief Releases notifications counted by notify(), once their
+     *        Observer is not touched anymore.
+     */
+    void released(uint64_t p_count)
+    {
+        if ( m_pending.fetch_sub(p_count) == p_count )
+        {
+            std::lock_guard<std::mutex> l_lock(m_flushMutex);
+            m_flushed.notify_all();
+        }
+    }
+
+    struct Worker
+    {
+        std::mutex        mutex;
+        std::deque<Task*> tasks;
+    };
+
+    Task* take(std::size_t p_self)
+    {
+        {
+            Worker& l_own = m_workers[p_self];
+            std::lock_guard<std::mutex> l_lock(l_own.mutex);
+            if ( !l_own.tasks.empty() )
+            {
+                Task* l_task = l_own.tasks.back();
+                l_own.tasks.pop_back();
+                return l_task;
+            }
+        }
+        for ( std::size_t i = 1; i < m_workers.size(); ++i )
+        {
+            Worker& l_victim = m_workers[(p_self + i) % m_workers.size()];
+            std::lock_guard<std::mutex> l_lock(l_victim.mutex);
+            if ( !l_victim.tasks.empty() )
+            {
+                Task* l_task = l_victim.tasks.front();
+                l_victim.tasks.pop_front();
+                return l_task;
+            }
+        }
+        return nullptr;
+    }
+
+    void work(std::size_t p_self)
+    {
+        t_worker = {this, p_self};
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> l_lock(m_idleMutex);
+                m_idle.wait(l_lock, [this] { return m_queued > 0 || m_stop; });
+                if ( m_queued == 0 ) return;
+                --m_queued;
+            }
+            // A task is ours to take, although maybe from another deque.
+            Task* l_task = nullptr;
+            while ( !(l_task = take(p_self)) )
+                std::this_thread::yield();
+            l_task->run();
+        }
+    }
+
+    static inline thread_local std::pair<const Dispatcher*, std::size_t> t_worker{nullptr, 0};
+
+    std::array<Shard, kShards> m_shards;
+    std::vector<Worker>      m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_next{0};
+
+    std::mutex               m_idleMutex;
+    std::condition_variable  m_idle;
+    std::size_t              m_queued{0};   /*!< Posted, not taken yet */
+    bool                     m_stop{false};
+
+    std::mutex               m_flushMutex;
+    std::condition_variable  m_flushed;
+    std::atomic<uint64_t>    m_pending{0};
+    std::atomic<uint64_t>    m_delivered{0};
+    std::atomic<uint64_t>    m_latencyNs{0};
+    std::atomic<uint64_t>    m_maxLatencyNs{0};
+};
+
+template <typename T>
+class Subject;
 
 /*!
  * @brief Observer
@@ -17,17 +358,288 @@ template <typename T>
 class Observer
 {
 public :
+    using Field = typename FieldTraits<T>::Field;
+    static_assert(FieldTraits<T>::kCount <= 64, "a FieldMask holds 64 fields");
+
     virtual ~Observer() = default;
-    virtual void update(T &p_src, const std::string &p_field) = 0;
+    virtual void update(T &p_src, Field p_field) = 0;
+
+    /*!
+     * @brief Called once when a transaction on p_src commits, with every
+     *        field it changed that this Observer subscribed to.
+     *        Defaults to one update() per field.
+     */
+    virtual void changed(T &p_src, FieldMask p_fields)
+    {
+        for ( std::size_t f = 0; f < FieldTraits<T>::kCount; ++f )
+            if ( (p_fields >> f) & 1 )
+                update(p_src, static_cast<Field>(f));
+    }
 
 protected:
     Observer() = default;
+
+private:
+    friend class Subject<T>;
+
+    /*!
+     * @brief Queues a notification on p_dispatcher.
+     */
+    void post(Dispatcher& p_dispatcher, T& p_src, Field p_field, FieldMask p_fields, bool p_coalesced)
+    {
+        p_dispatcher.notify({&Observer::deliver, this, &p_src, p_fields,
+                             static_cast<unsigned>(p_field), p_coalesced, Dispatcher::Clock::now()});
+    }
+
+    static void deliver(const Dispatcher::Notification& p_notification)
+    {
+        auto& l_obs = *static_cast<Observer*>(p_notification.observer);
+        auto& l_src = *static_cast<T*>(p_notification.src);
+        if ( p_notification.coalesced )
+            l_obs.changed(l_src, p_notification.fields);
+        else
+            l_obs.update(l_src, static_cast<Field>(p_notification.field));
+    }
+};
+
+/*!
+ * @brief Number of notifications the current thread is running, on any list.
+ */
+inline thread_local int t_notifying{0};
+
+/*!
+ * @brief ObserverList
+ *        Read-copy-update list of Observers, along with the fields
+ *        each of them subscribed to and a per-field index of them.
+ *
+ *        Readers (notify) register themselves in the current epoch and
+ *        walk an immutable snapshot : they never lock nor wait.
+ *        Writers (subscribe/unsubscribe) copy the snapshot under a lock,
+ *        publish the copy, then wait for a grace period (every reader
+ *        that could still see the old snapshot is done) to reclaim it.
+ *
+ *        A writer running inside a notification cannot wait for itself :
+ *        it leaves the old snapshot to the next writer that can, or to
+ *        the end of the outermost notification of the thread. Writers do
+ *        not hold the lock while waiting, so that notifications may edit
+ *        the list meanwhile.
+ */
+template <typename T>
+class ObserverList
+{
+public:
+    using Field   = typename FieldTraits<T>::Field;
+
+    struct Entry
+    {
+        Observer<T>* observer;
+        FieldMask    fields;
+    };
+
+    /*!
+     * @brief Snapshot
+     *        Subscriptions, and the index notify walks : the observers
+     *        of field f, in subscription order, are
+     *        observers[offsets[f], offsets[f + 1]).
+     */
+    struct Snapshot
+    {
+        struct Range
+        {
+            Observer<T>* const* first;
+            Observer<T>* const* last;
+
+            Observer<T>* const* begin() const { return first; }
+            Observer<T>* const* end  () const { return last;  }
+        };
+
+        Range interested(Field p_field) const
+        {
+            const auto f = static_cast<std::size_t>(p_field);
+            return { observers.data() + offsets[f], observers.data() + offsets[f + 1] };
+        }
+
+        void index()
+        {
+            constexpr std::size_t kCount = FieldTraits<T>::kCount;
+
+            offsets.assign(kCount + 1, 0);
+            for ( const auto& l_entry : entries )
+                for ( std::size_t f = 0; f < kCount; ++f )
+                    offsets[f + 1] += (l_entry.fields >> f) & 1;
+            for ( std::size_t f = 0; f < kCount; ++f )
+                offsets[f + 1] += offsets[f];
+
+            observers.resize(offsets.back());
+            std::vector<uint32_t> l_next(std::begin(offsets), std::end(offsets) - 1);
+            for ( const auto& l_entry : entries )
+                for ( std::size_t f = 0; f < kCount; ++f )
+                    if ( (l_entry.fields >> f) & 1 )
+                        observers[l_next[f]++] = l_entry.observer;
+        }
+
+        std::vector<Entry>         entries;
+        std::vector<uint32_t>      offsets = std::vector<uint32_t>(FieldTraits<T>::kCount + 1, 0);
+        std::vector<Observer<T>* > observers;
+    };
+
+    /*!
+     * @brief ReadGuard
+     *        Keeps the snapshot it loaded alive while in scope.
+     */
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(ObserverList& p_list) :
+        m_list(p_list), m_parity(p_list.m_epoch.load() & 1)
+        {
+            // Registering before loading the snapshot guarantees that a writer either
+            // waits for us or has already published the snapshot we are about to load.
+            m_list.m_readers[m_parity].fetch_add(1);
+            m_snapshot = m_list.m_snapshot.load();
+            ++t_notifying;
+        }
+        ~ReadGuard()
+        {
+            m_list.m_readers[m_parity].fetch_sub(1);
+
+            // Snapshots retired by edits made during notifications.
+            if ( --t_notifying == 0 && m_list.m_hasRetired.load() )
+                m_list.reclaim();
+        }
+
+        ReadGuard(const ReadGuard&)            = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        const Snapshot& snapshot() const { return *m_snapshot; }
+
+    private:
+        ObserverList&       m_list;
+        const uint64_t      m_parity;
+        const Snapshot*     m_snapshot;
+    };
+
+    ObserverList() : m_snapshot(new Snapshot) {}
+    ~ObserverList()
+    {
+        delete m_snapshot.load();
+        for ( auto l_old : m_retired )
+            delete l_old;
+    }
+
+    ObserverList(const ObserverList&)            = delete;
+    ObserverList& operator=(const ObserverList&) = delete;
+
+    /*!
+     * @brief Adds p_obs, or widens its fields if it is already there.
+     */
+    void add(Observer<T>* p_obs, FieldMask p_fields)
+    {
+        edit([p_obs, p_fields](std::vector<Entry>& p_next) {
+            auto l_it = std::find_if(std::begin(p_next), std::end(p_next),
+                                     [p_obs](const Entry& e) { return e.observer == p_obs; });
+            if ( l_it != std::end(p_next) )
+                l_it->fields |= p_fields;
+            else
+                p_next.push_back({p_obs, p_fields});
+        });
+    }
+
+    void remove(Observer<T>* p_obs)
+    {
+        edit([p_obs](std::vector<Entry>& p_next) {
+            p_next.erase(std::remove_if(std::begin(p_next), std::end(p_next),
+                                        [p_obs](const Entry& e) { return e.observer == p_obs; }),
+                         std::end(p_next));
+        });
+    }
+
+private:
+    template <typename F>
+    void edit(F p_edit)
+    {
+        {
+            std::lock_guard<std::mutex> l_lock(m_writer);
+
+            auto l_next = new Snapshot(*m_snapshot.load());
+            p_edit(l_next->entries);
+            l_next->index();
+            m_retired.push_back(m_snapshot.exchange(l_next));
+            m_hasRetired = true;
+        }
+
+        // Waiting from inside a notification could wait for ourselves,
+        // or for a thread waiting for us on another list.
+        if ( !t_notifying )
+            reclaim();
+    }
+
+    /*!
+     * @brief Frees the retired snapshots after a grace period. Must not
+     *        be called from a notification. Grace periods are serialized :
+     *        interleaved epoch flips could let a reclaimer skip the parity
+     *        a reader of its snapshots registered under.
+     */
+    void reclaim()
+    {
+        std::lock_guard<std::mutex>  l_reclaiming(m_reclaimer);
+        std::vector<const Snapshot*> l_retired;
+        {
+            std::lock_guard<std::mutex> l_lock(m_writer);
+            l_retired.swap(m_retired);
+            m_hasRetired = false;
+        }
+        if ( l_retired.empty() ) return;
+
+        // Two flips : a reader may have sampled the epoch just before the
+        // previous grace period and be registered under either parity.
+        // Readers of the snapshots retired before the swap registered before
+        // they were unpublished : a count reaching zero means they are done.
+        for ( int i = 0; i < 2; ++i )
+        {
+            const uint64_t l_parity = m_epoch.fetch_add(1) & 1;
+            while ( m_readers[l_parity].load() != 0 )
+                std::this_thread::yield();
+        }
+
+        for ( auto l_old : l_retired )
+            delete l_old;
+    }
+
+    std::mutex                    m_writer;
+    std::mutex                    m_reclaimer;
+    std::atomic<const Snapshot*>  m_snapshot;
+    std::vector<const Snapshot*>  m_retired;   /*!< Unpublished, maybe still read */
+    std::atomic<bool>             m_hasRetired{false};
+    std::atomic<uint64_t>         m_epoch{0};
+    mutable std::atomic<uint64_t> m_readers[2]{};
 };
 
 /*!
  * @brief Subject
  *        Defines an interface for adding/removing subcribers
  *        Keeps track of its Observers.
+ *
+ *        Observers subscribe to a set of fields (all of them by default)
+ *        and are only notified of changes to those : notify only walks
+ *        the observers of the changed field.
+ *
+ *        Changes made within a Transaction are only recorded : when it
+ *        commits, each interested Observer is told once, through changed(),
+ *        of all the fields it cares about that changed meanwhile.
+ *
+ *        notify, subscribe and unsubscribe may be called from any thread.
+ *        Observers (un)subscribed during a notification take part, or not,
+ *        in the next ones. Once unsubscribe returns - outside of a
+ *        notification - the Observer is not called anymore and may be
+ *        destroyed. Transactions however belong to the thread that mutates
+ *        the Subject.
+ *
+ *        With a Dispatcher, notify and commit only queue the notifications :
+ *        each Observer gets them in order, on one of the Dispatcher's threads,
+ *        and reads the Subject as it is by then, while it may be mutated :
+ *        T must declare FieldTraits<T>::kConcurrentReads. Flush the Dispatcher
+ *        before destroying an unsubscribed Observer, or the Subject.
  */
 template <typename T>
 class Subject
@@ -35,25 +647,143 @@ class Subject
 public:
     virtual ~Subject() = default;
 
-    void notify(T &p_src, const std::string &p_field)
+    using Field = typename FieldTraits<T>::Field;
+
+    /*!
+     * @brief Transaction
+     *        Coalesces the notifications of a Subject while in scope.
+     *        Transactions may nest : the outermost one commits.
+     */
+    class Transaction
     {
-        for ( auto l_obs : m_observers )
+    public:
+        explicit Transaction(Subject& p_subject) : m_subject(p_subject) { ++m_subject.m_depth; }
+        ~Transaction() { if ( --m_subject.m_depth == 0 ) m_subject.commit(); }
+
+        Transaction(const Transaction&)            = delete;
+        Transaction& operator=(const Transaction&) = delete;
+
+    private:
+        Subject& m_subject;
+    };
+
+    void notify(T &p_src, Field p_field)
+    {
+        if ( m_depth )
+        {
+            m_dirty |= fieldMask(p_field);
+            m_dirtySrc = &p_src;
+            return;
+        }
+
+        typename ObserverList<T>::ReadGuard l_guard(m_observers);
+        if ( Dispatcher* l_dispatcher = m_dispatcher.load() )
+        {
+            for ( auto l_obs : l_guard.snapshot().interested(p_field) )
+                l_obs->post(*l_dispatcher, p_src, p_field, 0, false);
+            return;
+        }
+        for ( auto l_obs : l_guard.snapshot().interested(p_field) )
             l_obs->update(p_src, p_field);
     }
-    void subscribe  (Observer<T>* p_obs) { m_observers.push_back(p_obs); }
-    void unsubscribe(Observer<T>* p_obs) 
+    void subscribe  (Observer<T>* p_obs, FieldMask p_fields = kAllFields) { m_observers.add(p_obs, p_fields); }
+    void unsubscribe(Observer<T>* p_obs)                                  { m_observers.remove(p_obs); }
+
+    /*!
+     * @brief Notifies asynchronously on p_dispatcher (nullptr : synchronously).
+     */
+    void setDispatcher(Dispatcher* p_dispatcher)
     {
-        m_observers.erase(std::remove(std::begin(m_observers), 
-                                      std::end  (m_observers), 
-                                      p_obs), 
-                          std::end(m_observers) );
+        static_assert(ConcurrentReads<T>::value,
+                      "Observers read T from the Dispatcher's threads : see FieldTraits<T>::kConcurrentReads");
+        m_dispatcher = p_dispatcher;
     }
 
 protected:
     Subject() = default;
-    
+
 private:
-    std::vector<Observer<T>* > m_observers;
+    void commit()
+    {
+        const FieldMask l_dirty = m_dirty;
+        m_dirty = 0;
+        if ( !l_dirty ) return;
+
+        Dispatcher* l_dispatcher = m_dispatcher.load();
+
+        typename ObserverList<T>::ReadGuard l_guard(m_observers);
+        for ( const auto& l_entry : l_guard.snapshot().entries )
+        {
+            if ( !(l_entry.fields & l_dirty) ) continue;
+
+            if ( l_dispatcher )
+                l_entry.observer->post(*l_dispatcher, *m_dirtySrc, Field{}, l_entry.fields & l_dirty, true);
+            else
+                l_entry.observer->changed(*m_dirtySrc, l_entry.fields & l_dirty);
+        }
+    }
+
+    ObserverList<T>          m_observers;
+    std::atomic<Dispatcher*> m_dispatcher{nullptr};
+    int                      m_depth{0};         /*!< Open transactions        */
+    FieldMask                m_dirty{0};         /*!< Fields changed meanwhile */
+    T*                       m_dirtySrc{nullptr};
+};
+
+/*!
+ * @brief StaticSubject
+ *        Subject whose Observer types are all known at compile time :
+ *        it keeps one array per type and notify calls each Observer's
+ *        update directly, so that the calls can be inlined.
+ *
+ *        Observers need not derive from Observer<T>, only provide an
+ *        update(T&, Field). Unlike Subject, it is not thread safe and
+ *        Observers must not (un)subscribe while being notified : use
+ *        Subject for runtime plug-ins.
+ */
+template <typename T, typename... Os>
+class StaticSubject
+{
+public:
+    using Field = typename FieldTraits<T>::Field;
+
+    template <typename O>
+    void subscribe(O* p_obs) { std::get<std::vector<O*> >(m_observers).push_back(p_obs); }
+
+    template <typename O>
+    void unsubscribe(O* p_obs)
+    {
+        auto& l_list = std::get<std::vector<O*> >(m_observers);
+        l_list.erase(std::remove(std::begin(l_list), std::end(l_list), p_obs), std::end(l_list));
+    }
+
+    void notify(T &p_src, Field p_field)
+    {
+        std::apply([&](auto&... p_lists) { (dispatch(p_lists, p_src, p_field), ...); }, m_observers);
+    }
+
+protected:
+    StaticSubject() = default;
+
+private:
+    template <typename O>
+    static void dispatch(const std::vector<O*>& p_list, T &p_src, Field p_field)
+    {
+        for ( auto l_obs : p_list )
+            l_obs->O::update(p_src, p_field);
+    }
+
+    std::tuple<std::vector<Os*>...> m_observers;
+};
+
+struct Person;
+
+template <>
+struct FieldTraits<Person>
+{
+    enum class Field : uint8_t { age, can_vote };
+    static constexpr std::size_t kCount = 2;
+    static constexpr bool kConcurrentReads = true;  /*!< The age is atomic */
 };
 
 struct Person : Subject<Person>
@@ -61,24 +791,24 @@ struct Person : Subject<Person>
     void set_age(uint8_t age)
     {
         auto old_can_vote = get_can_vote();
-        this->m_age = age;
-        notify(*this, "age");
+        this->m_age.store(age, std::memory_order_relaxed);
+        notify(*this, Field::age);
 
         if (old_can_vote != get_can_vote())
-            notify(*this, "can_vote");
+            notify(*this, Field::can_vote);
     }
-    uint8_t get_age() const { return m_age; }
-    bool get_can_vote() const { return m_age >= 16; }
+    uint8_t get_age() const { return m_age.load(std::memory_order_relaxed); }
+    bool get_can_vote() const { return get_age() >= 16; }
 
 private:
-    uint8_t m_age{0};
+    std::atomic<uint8_t> m_age{0};
 };
 
 struct TrafficAdministration : Observer<Person>
 {
-    void update(Person &p_src, const std::string &p_field)
+    void update(Person &p_src, Field p_field)
     {
-        if ( p_field == "age" )
+        if ( p_field == Field::age )
         {
             if ( p_src.get_age() < 17 )
                 std::cout << "Not old enough to drive!\n";
@@ -91,13 +821,389 @@ struct TrafficAdministration : Observer<Person>
     }
 };
 
-int main()
+// -------- BENCHMARKS -------- //
+struct Wide;
+
+template <>
+struct FieldTraits<Wide>
+{
+    enum class Field : uint8_t {};
+    static constexpr std::size_t kCount = 64;
+};
+
+/*!
+ * @brief A Subject with 64 fields, only ever notified by the benchmark.
+ */
+struct Wide : Subject<Wide> {};
+
+namespace bench {
+
+/*!
+ * @brief CPU time of the calling thread : unlike wall time, it does not
+ *        count the time other threads spend on the same cores.
+ */
+inline double threadCpuNs()
+{
+    timespec l_ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &l_ts);
+    return l_ts.tv_sec * 1e9 + l_ts.tv_nsec;
+}
+
+struct Counter : Observer<Person>
+{
+    void update(Person &, Field) override { ++m_calls; }
+    uint64_t m_calls{0};
+};
+
+/*!
+ * @brief Notify cost with 10k observers while 0..N threads keep
+ *        subscribing and unsubscribing observers of their own.
+ */
+void notifyUnderChurn()
+{
+    const std::size_t l_observers = 10000;
+    const int         l_notifies  = 2000;
+
+    for ( int l_churners : {0, 1, 2, 4} )
+    {
+        Person               l_subject;
+        std::vector<Counter> l_counters(l_observers);
+        for ( auto& l_counter : l_counters )
+            l_subject.subscribe(&l_counter);
+
+        std::atomic<bool>     l_stop{false};
+        std::atomic<uint64_t> l_churns{0};
+        std::vector<std::thread> l_threads;
+        for ( int t = 0; t < l_churners; ++t )
+            l_threads.emplace_back([&] {
+                Counter l_mine;
+                while ( !l_stop.load() )
+                {
+                    l_subject.subscribe  (&l_mine);
+                    l_subject.unsubscribe(&l_mine);
+                    l_churns.fetch_add(1);
+                }
+            });
+
+        const auto   l_wall = std::chrono::steady_clock::now();
+        const double l_cpu  = threadCpuNs();
+        for ( int i = 0; i < l_notifies; ++i )
+            l_subject.notify(l_subject, Person::Field::age);
+        const double l_cpuNs  = (threadCpuNs() - l_cpu) / l_notifies;
+        const double l_wallNs = std::chrono::duration<double, std::nano>(
+                                    std::chrono::steady_clock::now() - l_wall).count() / l_notifies;
+
+        l_stop = true;
+        for ( auto& l_thread : l_threads )
+            l_thread.join();
+
+        std::printf("notify observers=%zu churners=%d : %9.0f ns cpu, %10.0f ns wall per notify (%llu churns)\n",
+                    l_observers, l_churners, l_cpuNs, l_wallNs,
+                    static_cast<unsigned long long>(l_churns.load()));
+    }
+}
+
+struct WideCounter : Observer<Wide>
+{
+    void update(Wide &, Field) override { ++m_calls; }
+    uint64_t m_calls{0};
+};
+
+/*!
+ * @brief The former scheme : every observer gets every change
+ *        and string-compares the field name with its own.
+ */
+struct NamedObserver
+{
+    virtual ~NamedObserver() = default;
+    virtual void update(Wide &, const std::string &p_field)
+    {
+        if ( p_field == m_field ) ++m_calls;
+    }
+    std::string m_field;
+    uint64_t    m_calls{0};
+};
+
+/*!
+ * @brief 1000 (then 10k) observers spread over 64 fields, each
+ *        interested in one.
+ */
+void fieldFiltering()
+{
+    const std::size_t l_fields = FieldTraits<Wide>::kCount;
+
+    for ( std::size_t l_observers : {1000u, 10000u} )
+    {
+        const int l_notifies = 64 * 2000;
+
+        std::vector<std::string> l_names;
+        for ( std::size_t f = 0; f < l_fields; ++f )
+            l_names.push_back("field_" + std::to_string(f));
+
+        Wide l_subject;
+
+        // Strings
+        std::vector<NamedObserver> l_named(l_observers);
+        for ( std::size_t i = 0; i < l_observers; ++i )
+            l_named[i].m_field = l_names[i % l_fields];
+
+        auto l_start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < l_notifies; ++i )
+        {
+            const std::string l_field = l_names[i % l_fields];
+            for ( auto& l_obs : l_named )
+                l_obs.update(l_subject, l_field);
+        }
+        const double l_namedNs = std::chrono::duration<double, std::nano>(
+                                     std::chrono::steady_clock::now() - l_start).count() / l_notifies;
+
+        // Field ids and the per-field index
+        std::vector<WideCounter> l_counters(l_observers);
+        for ( std::size_t i = 0; i < l_observers; ++i )
+            l_subject.subscribe(&l_counters[i], fieldMask(static_cast<Wide::Field>(i % l_fields)));
+
+        l_start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < l_notifies; ++i )
+            l_subject.notify(l_subject, static_cast<Wide::Field>(i % l_fields));
+        const double l_maskNs = std::chrono::duration<double, std::nano>(
+                                    std::chrono::steady_clock::now() - l_start).count() / l_notifies;
+
+        uint64_t l_namedCalls = 0, l_maskCalls = 0;
+        for ( auto& l_obs : l_named    ) l_namedCalls += l_obs.m_calls;
+        for ( auto& l_obs : l_counters ) l_maskCalls  += l_obs.m_calls;
+
+        std::printf("fields observers=%-5zu fields=%zu : strings %8.0f ns, indexed %8.0f ns per notify (%llu/%llu updates)\n",
+                    l_observers, l_fields, l_namedNs, l_maskNs,
+                    static_cast<unsigned long long>(l_namedCalls),
+                    static_cast<unsigned long long>(l_maskCalls));
+    }
+}
+
+/*!
+ * @brief Counts updates and coalesced changes apart.
+ */
+struct ChangeCounter : Observer<Person>
+{
+    void update (Person &, Field)     override { ++m_calls; }
+    void changed(Person &, FieldMask) override { ++m_calls; }
+    uint64_t m_calls{0};
+};
+
+/*!
+ * @brief A stream of age updates, notified one by one or
+ *        committed every 1000 updates.
+ */
+void transactions()
+{
+    const std::size_t l_observers = 1000;
+    const int         l_updates   = 100000;
+    const int         l_batch     = 1000;
+
+    for ( bool l_transactional : {false, true} )
+    {
+        Person                     l_subject;
+        std::vector<ChangeCounter> l_counters(l_observers);
+        for ( auto& l_counter : l_counters )
+            l_subject.subscribe(&l_counter);
+
+        const auto l_start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < l_updates; i += l_batch )
+        {
+            if ( l_transactional )
+            {
+                Person::Transaction l_tx(l_subject);
+                for ( int j = 0; j < l_batch; ++j )
+                    l_subject.set_age(static_cast<uint8_t>(j % 30));
+            }
+            else
+            {
+                for ( int j = 0; j < l_batch; ++j )
+                    l_subject.set_age(static_cast<uint8_t>(j % 30));
+            }
+        }
+        const double l_ns = std::chrono::duration<double, std::nano>(
+                                std::chrono::steady_clock::now() - l_start).count() / l_updates;
+
+        uint64_t l_calls = 0;
+        for ( auto& l_counter : l_counters ) l_calls += l_counter.m_calls;
+
+        std::printf("transactions=%-3s observers=%zu updates=%d : %9.1f ns per set_age, %llu observer calls\n",
+                    l_transactional ? "on" : "off", l_observers, l_updates, l_ns,
+                    static_cast<unsigned long long>(l_calls));
+    }
+}
+
+/*!
+ * @brief Blocks for 20 us (or as long as the scheduler makes it) per
+ *        notification, like an Observer writing to a disk.
+ */
+struct SlowObserver : Observer<Person>
+{
+    void update(Person &, Field) override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        ++m_calls;
+    }
+    uint64_t m_calls{0};
+};
+
+/*!
+ * @brief set_age latency with 100 fast observers and a slow one,
+ *        notified inline or on a Dispatcher.
+ */
+void asyncDispatch()
 {
+    const int l_updates = 2000;
+
+    for ( bool l_async : {false, true} )
+    {
+        Dispatcher           l_dispatcher(4);
+        Person               l_subject;
+        SlowObserver         l_slow;
+        std::vector<Counter> l_fast(100);
+        l_subject.subscribe(&l_slow, fieldMask(Person::Field::age));
+        for ( auto& l_counter : l_fast )
+            l_subject.subscribe(&l_counter, fieldMask(Person::Field::age));
+        if ( l_async )
+            l_subject.setDispatcher(&l_dispatcher);
+
+        std::vector<double> l_latencies;
+        const auto l_start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < l_updates; ++i )
+        {
+            const auto l_before = std::chrono::steady_clock::now();
+            l_subject.set_age(static_cast<uint8_t>(i % 100));
+            l_latencies.push_back(std::chrono::duration<double, std::nano>(
+                                      std::chrono::steady_clock::now() - l_before).count());
+        }
+        const auto l_depth = l_dispatcher.stats().depth;
+        l_dispatcher.flush();
+        const double l_totalMs = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - l_start).count();
+
+        std::sort(std::begin(l_latencies), std::end(l_latencies));
+        const auto l_stats = l_dispatcher.stats();
+        std::printf("dispatch=%-5s set_age p50 %8.0f ns, p99 %8.0f ns ; all delivered after %6.1f ms"
+                    " (queue depth %llu before flush, mean latency %.0f us, max %.0f us)\n",
+                    l_async ? "async" : "sync",
+                    l_latencies[l_latencies.size() / 2], l_latencies[l_latencies.size() * 99 / 100],
+                    l_totalMs, static_cast<unsigned long long>(l_depth),
+                    l_stats.meanLatencyNs / 1e3, l_stats.maxLatencyNs / 1e3);
+    }
+}
+
+/*!
+ * @brief Person, statically bound to its Observer types.
+ */
+template <typename... Os>
+struct StaticPerson : StaticSubject<StaticPerson<Os...>, Os...>
+{
+    using Field = typename FieldTraits<Person>::Field;
+
+    void set_age(uint8_t age)
+    {
+        auto old_can_vote = get_can_vote();
+        this->m_age = age;
+        this->notify(*this, Field::age);
+
+        if (old_can_vote != get_can_vote())
+            this->notify(*this, Field::can_vote);
+    }
+    bool get_can_vote() const { return m_age >= 16; }
+
+private:
+    uint8_t m_age{0};
+};
+
+/*!
+ * @brief Same observers, for either subject.
+ */
+struct AgeCounter : Observer<Person>
+{
+    void update(Person &, Field p_field) override { m_calls += p_field == Field::age; }
+    template <typename S>
+    void update(S &, Field p_field)               { m_calls += p_field == Field::age; }
+    uint64_t m_calls{0};
+};
+
+struct VoteCounter : Observer<Person>
+{
+    void update(Person &, Field p_field) override { m_calls += p_field == Field::can_vote; }
+    template <typename S>
+    void update(S &, Field p_field)               { m_calls += p_field == Field::can_vote; }
+    uint64_t m_calls{0};
+};
+
+} // namespace bench
+
+template <typename... Os>
+struct FieldTraits<bench::StaticPerson<Os...> > : FieldTraits<Person> {};
+
+namespace bench {
+
+/*!
+ * @brief 1000 observers of two types, on the dynamic Subject and on
+ *        a StaticSubject.
+ */
+void staticDispatch()
+{
+    const std::size_t l_observers = 1000;
+    const int         l_updates   = 20000;
+
+    std::vector<AgeCounter>  l_ages (l_observers / 2);
+    std::vector<VoteCounter> l_votes(l_observers / 2);
+
+    Person l_dynamic;
+    for ( std::size_t i = 0; i < l_observers / 2; ++i )
+    {
+        l_dynamic.subscribe(&l_ages [i]);
+        l_dynamic.subscribe(&l_votes[i]);
+    }
+
+    StaticPerson<AgeCounter, VoteCounter> l_static;
+    for ( std::size_t i = 0; i < l_observers / 2; ++i )
+    {
+        l_static.subscribe(&l_ages [i]);
+        l_static.subscribe(&l_votes[i]);
+    }
+
+    auto l_run = [&](auto& p_subject) {
+        const auto l_start = std::chrono::steady_clock::now();
+        for ( int i = 0; i < l_updates; ++i )
+            p_subject.set_age(static_cast<uint8_t>(i % 30));
+        return std::chrono::duration<double, std::nano>(
+                   std::chrono::steady_clock::now() - l_start).count() / l_updates;
+    };
+    const double l_dynamicNs = l_run(l_dynamic);
+    const double l_staticNs  = l_run(l_static);
+
+    uint64_t l_calls = 0;
+    for ( auto& l_obs : l_ages  ) l_calls += l_obs.m_calls;
+    for ( auto& l_obs : l_votes ) l_calls += l_obs.m_calls;
+
+    std::printf("subject observers=%zu : dynamic %8.0f ns, static %8.0f ns per set_age (%llu counted)\n",
+                l_observers, l_dynamicNs, l_staticNs, static_cast<unsigned long long>(l_calls));
+}
+
+} // namespace bench
+
+int main(int argc, char** argv)
+{
+    if ( argc > 1 && std::strcmp(argv[1], "--bench") == 0 )
+    {
+        bench::notifyUnderChurn();
+        bench::fieldFiltering();
+        bench::transactions();
+        bench::asyncDispatch();
+        bench::staticDispatch();
+        return EXIT_SUCCESS;
+    }
+
     Person p;
     TrafficAdministration ta;
-    p.subscribe(&ta);
+    p.subscribe(&ta, fieldMask(Person::Field::age));
     p.set_age(16);
     p.set_age(17);
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}